@@ -0,0 +1,140 @@
+#pragma once
+
+// Header file with lock-free primitives for sharing data between interrupt and main loop
+//
+// Only atomic load and store of 32-bit words are used (no read-modify-write),
+// so the primitives work on Cortex-M0+ (without LDREX/STREX), Cortex-M4 and host.
+// Every primitive has exactly one writer - the write must not be interrupted by the reader
+// (e.g. writer in the interrupt, reader in the main loop).
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+namespace nxpcup {
+
+/**
+ * Counter of events which is never reset (e.g. pulses from encoder).
+ *
+ * The writer only increments, the reader takes the difference from the previous reading -
+ * no event is lost between reading and reset.
+ */
+class MonotonicCounter {
+public:
+    /**
+     * Add one event (writer side - e.g. interrupt).
+     */
+    void increment()
+    {
+        m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Take the number of events since the previous call (reader side).
+     */
+    uint32_t take()
+    {
+        uint32_t count = m_count.load(std::memory_order_acquire);
+        uint32_t difference = count - m_lastTaken;
+        m_lastTaken = count;
+        return difference;
+    }
+
+    /**
+     * Get the number of all events (overflows after 2^32 events).
+     */
+    uint32_t total() const { return m_count.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<uint32_t> m_count { 0 };
+    uint32_t m_lastTaken = 0;
+};
+
+/**
+ * Consistent snapshot of a larger structure written by one writer (sequence lock).
+ *
+ * The writer never waits. The reader repeats the copy when the writer
+ * changed the data during the reading. The data are stored as relaxed atomic
+ * words - the reader may copy them during the write without data race.
+ *
+ * @tparam T type of the data - trivially copyable
+ */
+template <typename T>
+class Seqlock {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "data must be trivially copyable");
+
+    /**
+     * Publish new data (writer side - e.g. interrupt).
+     *
+     * @param value new data
+     */
+    void write(const T& value)
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed); // odd = writing
+        std::atomic_thread_fence(std::memory_order_release);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        for (std::size_t i = 0; i < WORDS; i++) {
+            uint32_t word = 0;
+            memcpy(&word, bytes + i * sizeof(word), wordSize(i));
+            m_words[i].store(word, std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * Try to copy the data (reader side).
+     *
+     * @param value variable for the copy
+     * @return false if the writer changed the data during the copy (the copy is not valid)
+     */
+    bool tryRead(T& value) const
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            return false;
+        }
+        char* bytes = reinterpret_cast<char*>(&value);
+        for (std::size_t i = 0; i < WORDS; i++) {
+            uint32_t word = m_words[i].load(std::memory_order_relaxed);
+            memcpy(bytes + i * sizeof(word), &word, wordSize(i));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    /**
+     * Copy the data (reader side) - repeat until the copy is consistent.
+     *
+     * @param value variable for the copy
+     */
+    void read(T& value) const
+    {
+        while (!tryRead(value)) {
+        }
+    }
+
+    /**
+     * Get the number of writes (changes when new data is published).
+     */
+    uint32_t version() const { return m_sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    /**
+     * Number of bytes of the data in the word (the last word may be partial).
+     */
+    static constexpr std::size_t wordSize(std::size_t index)
+    {
+        return std::min(sizeof(uint32_t), sizeof(T) - index * sizeof(uint32_t));
+    }
+
+    std::atomic<uint32_t> m_sequence { 0 };
+    std::atomic<uint32_t> m_words[WORDS] = {};
+};
+
+} // namespace nxpcup
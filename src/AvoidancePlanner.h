@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Lateral offset path around the obstacle over the encoder distance.
+ *
+ * The offset from the lane center follows quintic profile (zero lateral speed and acceleration
+ * at both ends): approach (actual offset -> target), pass (target), return (actual offset -> 0).
+ * Every phase starts from the actual offset - the path stays continuous when the target
+ * moves or the obstacle side changes during the return. During the pass the target changes
+ * smaller than @{Config::replanDeadband} (noise of the measured position) are ignored.
+ * Length of the approach and return scale with the speed.
+ */
+class AvoidancePlanner {
+public:
+    struct Config {
+        float approachTime = 0.2; /**< duration of the approach to the side in seconds **/
+        float returnTime = 0.3; /**< duration of the return to the center in seconds **/
+        float minimalDistance = 0.1; /**< minimal length of the approach and return in meters **/
+        float replanDeadband = 0.02; /**< change of the target during the pass which starts new approach (in the units of the target) **/
+    };
+
+    enum class Phase {
+        idle,
+        approach,
+        pass,
+        back
+    };
+
+    /**
+     * Constructor of class AvoidancePlanner.
+     *
+     * @param config struct @{Config}
+     */
+    AvoidancePlanner(Config config)
+        : m_config(config)
+    {
+    }
+
+    /**
+     * Start the approach to the side of the obstacle.
+     *
+     * @param encoderDistance distance from one encoder in meters
+     * @param speed actual speed in [m/s]
+     */
+    void start(float encoderDistance, float speed)
+    {
+        m_approachLength = std::max(speed * m_config.approachTime, m_config.minimalDistance);
+        begin(Phase::approach, encoderDistance, m_approachLength);
+    }
+
+    /**
+     * Start the return to the center of the lane.
+     *
+     * @param encoderDistance distance from one encoder in meters
+     * @param speed actual speed in [m/s]
+     */
+    void finish(float encoderDistance, float speed)
+    {
+        if (m_phase == Phase::idle || m_phase == Phase::back) {
+            return;
+        }
+        begin(Phase::back, encoderDistance, std::max(speed * m_config.returnTime, m_config.minimalDistance));
+    }
+
+    /**
+     * Get the lateral offset of the path.
+     *
+     * @param target offset next to the obstacle (e.g. in meters, positive = right) - can change during the avoiding
+     * @param encoderDistance distance from one encoder in meters
+     * @return offset from the lane center in the units of the target
+     */
+    float offset(float target, float encoderDistance)
+    {
+        if (m_phase == Phase::pass && nxpcup::abs(target - m_offset) > m_config.replanDeadband) { // new target - move to it smoothly
+            begin(Phase::approach, encoderDistance, m_approachLength);
+        }
+        float progress = nxpcup::clamp<float>((encoderDistance - m_startDistance) / m_length, 0, 1);
+        switch (m_phase) {
+        case Phase::idle:
+        default:
+            m_offset = 0;
+            break;
+        case Phase::approach:
+            m_offset = m_startOffset + (target - m_startOffset) * quintic(progress);
+            if (progress == 1) {
+                m_offset = target;
+                m_phase = Phase::pass;
+            }
+            break;
+        case Phase::pass: // keep the reached offset - the target changed within the deadband
+            break;
+        case Phase::back:
+            m_offset = m_startOffset * (1 - quintic(progress));
+            if (progress == 1) {
+                m_phase = Phase::idle;
+            }
+            break;
+        }
+        return m_offset;
+    }
+
+    /**
+     * Get the last calculated offset of the path.
+     */
+    float offset() const { return m_offset; }
+
+    /**
+     * Get actual phase of the avoiding.
+     */
+    Phase phase() const { return m_phase; }
+
+    /**
+     * Return true if the path is not in the lane center.
+     */
+    bool isActive() const { return m_phase != Phase::idle; }
+
+    /**
+     * Get the actual configuration of the @{AvoidancePlanner}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{AvoidancePlanner}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(const Config& config)
+    {
+        m_config = config;
+        reset();
+    }
+
+    /**
+     * Stop the avoiding immediately.
+     */
+    void reset()
+    {
+        m_phase = Phase::idle;
+        m_offset = 0;
+    }
+
+private:
+    /**
+     * Quintic smoothstep 10t^3 - 15t^4 + 6t^5.
+     */
+    static float quintic(float t)
+    {
+        return t * t * t * (10 + t * (-15 + 6 * t));
+    }
+
+    /**
+     * Start new phase from the last offset (the path stays continuous).
+     */
+    void begin(Phase phase, float encoderDistance, float length)
+    {
+        m_startOffset = m_offset;
+        m_phase = phase;
+        m_startDistance = encoderDistance;
+        m_length = length;
+    }
+
+    Config m_config;
+
+    Phase m_phase = Phase::idle;
+    float m_startDistance = 0;
+    float m_length = 1;
+    float m_approachLength = 1;
+    float m_startOffset = 0;
+    float m_offset = 0;
+};
+
+} // namespace nxpcup
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+
+#include "mbed.h"
+
+#include "InterruptAnalogIn.h"
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Measurement of the battery voltage in the background.
+ *
+ * Used by @{Motor::setBattery()} for compensation of the power - the same command
+ * gives the same effective voltage from full to empty battery.
+ */
+class Battery {
+public:
+    struct Config {
+        PinName analogPin; /**< analog in pin with the divided battery voltage **/
+        float dividerRatio = 3; /**< battery voltage / voltage on the pin **/
+        float referenceVoltage = 3.3; /**< voltage of the ADC reference **/
+        float nominalVoltage = 7.2; /**< voltage for which the motor power is not changed **/
+        float lowVoltage = 6.4; /**< under this voltage is the battery reported as low **/
+        float lowHysteresis = 0.2; /**< the low battery is released over (lowVoltage + lowHysteresis) **/
+        uint8_t averageShift = 4; /**< weight of new sample in moving average is 1 / 2^averageShift **/
+        uint16_t samplePeriodUs = 10000; /**< period of the sampling in microseconds **/
+    };
+
+    static constexpr int MAX_COMPENSATION_PERCENT = 200; // limit for unplugged or broken measurement
+
+    /**
+     * Constructor of class Battery.
+     *
+     * Start the background sampling of the voltage.
+     *
+     * @param config struct @{Config}
+     */
+    Battery(const Config& config)
+        : m_config(config)
+        , m_nominalRaw(toRaw(config.nominalVoltage))
+        , m_lowRaw(toRaw(config.lowVoltage))
+        , m_releaseRaw(toRaw(config.lowVoltage + config.lowHysteresis))
+        , m_analogIn(config.analogPin)
+    {
+        sample();
+        m_ticker.attach_us(callback(this, &Battery::sample), config.samplePeriodUs);
+    }
+
+    /**
+     * Get the filtered battery voltage.
+     */
+    float voltage() const
+    {
+        return m_raw.load() * m_config.referenceVoltage * m_config.dividerRatio / UINT16_MAX;
+    }
+
+    /**
+     * Return true if the battery voltage is under @{Config::lowVoltage}.
+     */
+    bool isLow() const { return m_isLow.load(); }
+
+    /**
+     * Scale the motor power from nominal to actual voltage.
+     *
+     * @param power required power at @{Config::nominalVoltage}
+     * @return power for the actual voltage (not clamped)
+     */
+    int compensate(int power) const
+    {
+        return power * scale();
+    }
+
+    /**
+     * Get the ratio of nominal and actual voltage (limited by @{MAX_COMPENSATION_PERCENT}).
+     */
+    float scale() const
+    {
+        uint32_t raw = std::max<uint32_t>(m_raw.load(), (m_nominalRaw * 100) / MAX_COMPENSATION_PERCENT);
+        return float(m_nominalRaw) / raw;
+    }
+
+private:
+    /**
+     * Convert the battery voltage to the ADC value.
+     */
+    uint32_t toRaw(float voltage) const
+    {
+        return voltage / m_config.dividerRatio / m_config.referenceVoltage * UINT16_MAX;
+    }
+
+    /**
+     * Sample the voltage - called by ticker.
+     */
+    void sample()
+    {
+        uint16_t raw = m_analogIn.read_u16();
+        if (m_accumulator == 0) {
+            m_accumulator = uint32_t(raw) << m_config.averageShift;
+        }
+        m_accumulator += raw - (m_accumulator >> m_config.averageShift);
+        uint32_t filtered = m_accumulator >> m_config.averageShift;
+        m_raw.store(filtered);
+
+        if (filtered < m_lowRaw) {
+            m_isLow.store(true);
+        } else if (filtered > m_releaseRaw) {
+            m_isLow.store(false);
+        }
+    }
+
+    Config m_config;
+    const uint32_t m_nominalRaw;
+    const uint32_t m_lowRaw;
+    const uint32_t m_releaseRaw;
+
+    InterruptAnalogIn m_analogIn;
+    Ticker m_ticker;
+
+    uint32_t m_accumulator = 0; // owned by the interrupt
+    std::atomic<uint32_t> m_raw { 0 };
+    std::atomic<bool> m_isLow { false };
+};
+
+} // namespace nxpcup
@@ -1,21 +1,59 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <math.h>
 #include <stdint.h>
 
+#include "Image.h"
+#include "util.h"
+
 namespace nxpcup {
 
-class BorderDetector {
+/**
+ * Detector of the road borders in the line image (e.g. difference image from camera).
+ *
+ * @tparam T type of the pixel
+ * @tparam N number of pixels in the image
+ */
+template <typename T = uint16_t, std::size_t N = 128>
+class BasicBorderDetector {
 public:
-    using ImageType = Camera::ImageType;
+    using ImageType = T;
+
+    enum class ThresholdMode {
+        fixed, /**< threshold set once in @{initalize()} **/
+        adaptive /**< threshold of every region follows the actual image **/
+    };
+
+    enum class SearchMode {
+        linear, /**< search the border in all pixels of the half **/
+        multiresolution /**< search in the downsampled image, refine in the window at full resolution
+                          *  (saves time only with ThresholdMode::adaptive - it reuses the maxima of the regions) **/
+    };
 
     struct Config {
-        static constexpr int dataSize = Camera::ImageSize;
+        ThresholdMode thresholdMode = ThresholdMode::fixed; /**< mode of the threshold for the border **/
+        uint8_t adaptivePercent = 50; /**< region threshold between mean (0) and maximum (100) of the region **/
+        uint8_t minimalContrast = 3; /**< region threshold is at least mean of the whole image multiplied by this value **/
+        uint8_t adaptationShift = 3; /**< the threshold moves by 1 / 2^adaptationShift of the difference per frame **/
+        uint16_t hysteresis = PIXEL_RANGE / 256; /**< smaller differences of the threshold are ignored (256 for 16-bit pixels, 1 for 8-bit) **/
+        SearchMode searchMode = SearchMode::linear; /**< search of the border when it is lost **/
+
+        static constexpr uint32_t PIXEL_RANGE = uint32_t(std::numeric_limits<T>::max()) + 1;
+        static constexpr int dataSize = N;
         static constexpr int CENTER = dataSize / 2;
         static constexpr int RIGHT_BORDER = dataSize;
         static constexpr int NEIGHBORHOOD = 6;
+        static constexpr int REGIONS = 8;
+        static constexpr int REGION_SIZE = (dataSize + REGIONS - 1) / REGIONS;
+        static constexpr int PYRAMID_FACTOR = REGION_SIZE; /**< pixels of the image in one pixel of the downsampled image (one region) **/
+        static constexpr int PYRAMID_SIZE = dataSize / PYRAMID_FACTOR;
 
         static_assert(NEIGHBORHOOD >= 0);
+        static_assert(dataSize >= REGIONS);
+        static_assert(PYRAMID_SIZE <= REGIONS);
     };
 
     /**
@@ -23,7 +61,8 @@ public:
      *
      * @param config struct @{Config}
      */
-    BorderDetector(Config config)
+    BasicBorderDetector(Config config)
+        : m_config(config)
     {
     }
 
@@ -38,8 +77,20 @@ public:
         const std::array<ImageType, Config::dataSize>& data,
         const uint8_t percentCoefficient = 100)
     {
-        uint16_t maxValue = findMaxValue(data);
+        ImageType maxValue = findMaxValue(data);
         m_threshold = (maxValue * percentCoefficient) / 100;
+        m_regionThresholds.fill(m_threshold);
+    }
+
+    /**
+     * Initialize the detector and set threshold value.
+     *
+     * @param image image from camera (no copy)
+     * @param percentCoefficient how many percent of error return (0 <-> 100)
+     */
+    void initalize(const Image<ImageType, N>& image, const uint8_t percentCoefficient = 100)
+    {
+        initalize(image.data, percentCoefficient);
     }
 
     /**
@@ -50,6 +101,11 @@ public:
      */
     int findBorder(const std::array<ImageType, Config::dataSize>& data)
     {
+        m_isPyramidValid = false;
+        if (m_config.thresholdMode == ThresholdMode::adaptive) {
+            updateRegionThresholds(data);
+        }
+
         int16_t previousLeftBorder = m_leftBorder;
         int16_t previousRightBorder = m_rightBorder;
         int16_t middle = (previousRightBorder + previousLeftBorder) / 2;
@@ -64,15 +120,15 @@ public:
         }
 
         if (!findPreviousLeft) {
-            int16_t leftMaxBorderIndex = std::max_element(data.begin(), data.begin() + middle) - data.begin();
-            if (data[leftMaxBorderIndex] > m_threshold) {
+            int16_t leftMaxBorderIndex = findMaxIndex(data, 0, middle);
+            if (data[leftMaxBorderIndex] > threshold(leftMaxBorderIndex)) {
                 m_leftBorder = leftMaxBorderIndex;
             }
         }
 
         if (!findPreviousRight) {
-            int16_t rightMaxBorderIndex = std::max_element(data.begin() + middle, data.end()) - data.begin();
-            if (data[rightMaxBorderIndex] > m_threshold) {
+            int16_t rightMaxBorderIndex = findMaxIndex(data, middle, Config::dataSize);
+            if (data[rightMaxBorderIndex] > threshold(rightMaxBorderIndex)) {
                 m_rightBorder = rightMaxBorderIndex;
             }
         }
@@ -80,6 +136,16 @@ public:
         return 0;
     }
 
+    /**
+     * Find the left and right border in the image.
+     *
+     * @param image image from camera (no copy)
+     */
+    int findBorder(const Image<ImageType, N>& image)
+    {
+        return findBorder(image.data);
+    }
+
     /**
      * Get distance just with information about left border.
      * Take data from last call @{findBorder}.
@@ -133,6 +199,35 @@ public:
         return m_rightBorder;
     }
 
+    /**
+     * Get the threshold set by @{initalize()} or @{setThreshold()}.
+     */
+    ImageType threshold() const { return m_threshold; }
+
+    /**
+     * Set the threshold without the image (e.g. saved in @{ParameterStore}).
+     *
+     * @param threshold value of the border
+     */
+    void setThreshold(ImageType threshold)
+    {
+        m_threshold = threshold;
+        m_regionThresholds.fill(m_threshold);
+    }
+
+    /**
+     * Get the threshold for the pixel.
+     *
+     * @param index of the pixel (0 <-> @{Config::dataSize} - 1)
+     */
+    ImageType threshold(int index) const
+    {
+        if (m_config.thresholdMode == ThresholdMode::adaptive) {
+            return m_regionThresholds[index / Config::REGION_SIZE];
+        }
+        return m_threshold;
+    }
+
 private:
     /**
      * Find the maximal value in the input data.
@@ -154,6 +249,128 @@ private:
         return data[at];
     }
 
+    /**
+     * Find the position of the maximal value in the range (the first one if there are more).
+     *
+     * In @{SearchMode::multiresolution} only the downsampled image is searched and
+     * the result is refined in one window of @{Config::PYRAMID_FACTOR} pixels.
+     * The downsampled image is made only for the searched range if it isn't
+     * made by @{updateRegionThresholds()}. The result is the same as from std::max_element.
+     *
+     * @param data image from camera
+     * @param begin first pixel of the range
+     * @param end pixel after the range
+     * @return index of the maximal value (end if the range is empty)
+     */
+    int findMaxIndex(const std::array<ImageType, Config::dataSize>& data, int begin, int end)
+    {
+        if (m_config.searchMode != SearchMode::multiresolution) {
+            return std::max_element(data.begin() + begin, data.begin() + end) - data.begin();
+        }
+        // the blocks fully inside the range are searched in the downsampled image
+        int firstBlock = (begin + Config::PYRAMID_FACTOR - 1) / Config::PYRAMID_FACTOR;
+        int endBlock = std::max(end / Config::PYRAMID_FACTOR, firstBlock);
+        int headEnd = std::min(firstBlock * Config::PYRAMID_FACTOR, end);
+        int tailBegin = std::max(endBlock * Config::PYRAMID_FACTOR, headEnd);
+        if (!m_isPyramidValid) {
+            updatePyramid(data, firstBlock, endBlock);
+        }
+
+        int best = end;
+        int bestBlock = -1;
+        ImageType bestValue = 0;
+        auto isBetter = [&](ImageType value) {
+            return (best == end && bestBlock < 0) || value > bestValue;
+        };
+
+        for (int i = begin; i < headEnd; i++) {
+            if (isBetter(data[i])) {
+                best = i;
+                bestValue = data[i];
+            }
+        }
+        for (int block = firstBlock; block < endBlock; block++) {
+            if (isBetter(m_pyramid[block])) {
+                bestBlock = block;
+                bestValue = m_pyramid[block];
+            }
+        }
+        if (bestBlock >= 0) {
+            // refine in the window of the block at full resolution
+            best = bestBlock * Config::PYRAMID_FACTOR;
+            while (data[best] != bestValue) {
+                best++;
+            }
+        }
+        for (int i = tailBegin; i < end; i++) {
+            if (isBetter(data[i])) {
+                best = i;
+                bestValue = data[i];
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Downsample the image by maximum of every @{Config::PYRAMID_FACTOR} pixels.
+     *
+     * @param data image from camera
+     * @param firstBlock first pixel of the downsampled image
+     * @param endBlock pixel after the range of the downsampled image
+     */
+    void updatePyramid(const std::array<ImageType, Config::dataSize>& data, int firstBlock, int endBlock)
+    {
+        for (int block = firstBlock; block < endBlock; block++) {
+            const ImageType* pixel = data.data() + block * Config::PYRAMID_FACTOR;
+            m_pyramid[block] = *std::max_element(pixel, pixel + Config::PYRAMID_FACTOR);
+        }
+    }
+
+    /**
+     * Move the threshold of every region towards the threshold of actual image.
+     *
+     * One pass over the image - mean and maximum of every region
+     * (the maxima are the downsampled image for @{SearchMode::multiresolution}).
+     *
+     * @param data image from camera
+     */
+    void updateRegionThresholds(const std::array<ImageType, Config::dataSize>& data)
+    {
+        std::array<int32_t, Config::REGIONS> means;
+        std::array<ImageType, Config::REGIONS> maxima;
+        uint32_t imageSum = 0;
+        for (int region = 0; region < Config::REGIONS; region++) {
+            int begin = region * Config::REGION_SIZE;
+            int end = std::min((region + 1) * Config::REGION_SIZE, Config::dataSize);
+            uint32_t sum = 0;
+            ImageType maximum = 0;
+            for (int i = begin; i < end; i++) {
+                sum += data[i];
+                maximum = std::max(maximum, data[i]);
+            }
+            imageSum += sum;
+            means[region] = end > begin ? sum / (end - begin) : 0;
+            maxima[region] = maximum;
+        }
+        // the downsampled image is the maxima of the regions (no extra work)
+        std::copy(maxima.begin(), maxima.begin() + Config::PYRAMID_SIZE, m_pyramid.begin());
+        m_isPyramidValid = true;
+        int32_t floor = (imageSum / Config::dataSize) * m_config.minimalContrast;
+
+        for (int region = 0; region < Config::REGIONS; region++) {
+            int32_t candidate = means[region] + ((maxima[region] - means[region]) * m_config.adaptivePercent) / 100;
+            candidate = std::max(candidate, floor);
+            int32_t difference = candidate - m_regionThresholds[region];
+            if (nxpcup::abs(difference) > m_config.hysteresis) {
+                int32_t step = difference / (1 << m_config.adaptationShift);
+                if (step == 0) { // small pixel range - move at least by one level
+                    step = nxpcup::sign(difference);
+                }
+                // the floor could be over the range of the pixel (e.g. 8-bit pixels)
+                m_regionThresholds[region] = nxpcup::clamp<int32_t>(m_regionThresholds[region] + step, 0, std::numeric_limits<ImageType>::max());
+            }
+        }
+    }
 
     /**
      * Look for the border around previous border in define neighborhood (@{Config::NEIGHBORHOOD})
@@ -169,11 +386,11 @@ private:
         int& border)
     {
         bool find = false;
-        uint16_t maxValue = m_threshold;
+        ImageType maxValue = 0;
         int index = nxpcup::clamp<int>(previousBorder - Config::NEIGHBORHOOD, 0, Config::dataSize - 1);
         int indexMax = nxpcup::clamp<int>(previousBorder + Config::NEIGHBORHOOD, 0, Config::dataSize - 1);
         for (; index <= indexMax; ++index) {
-            if (data[index] > maxValue) {
+            if (data[index] > maxValue && data[index] > threshold(index)) {
                 maxValue = data[index];
                 border = index;
                 find = true;
@@ -184,10 +401,19 @@ private:
 
     int m_leftBorder = 0;
     int m_rightBorder = Config::RIGHT_BORDER;
-    int m_endflag = 0;
 
     int m_distanceCenter = Config::CENTER;
-    uint16_t m_threshold = 0;
+    ImageType m_threshold = 0;
+
+    Config m_config;
+    std::array<ImageType, Config::REGIONS> m_regionThresholds = {};
+    std::array<ImageType, Config::PYRAMID_SIZE> m_pyramid = {};
+    bool m_isPyramidValid = false; // the whole downsampled image is made for the actual image
 };
 
+/**
+ * Border detector for the image from @{Camera} (128 pixels, uint16_t).
+ */
+using BorderDetector = BasicBorderDetector<>;
+
 } // namespace nxpcup
@@ -1,9 +1,15 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <atomic>
 
 #include "mbed.h"
 
+#include "InterruptAnalogIn.h"
+#include "RingBuffer.h"
+#include "util.h"
+
 namespace nxpcup {
 
 using ButtonId = int;
@@ -13,28 +19,62 @@ public:
     struct Config {
         struct ButtonSetting {
             uint16_t id; /**< identificator of the button **/
-            uint16_t boundaryValue; /**< upper boundary value for this button **/
+            uint16_t boundaryValue; /**< upper boundary value for this button (0 = unused setting) **/
         };
 
+        static constexpr int MAX_BUTTONS = 8;
+        static constexpr uint16_t DEFAULT_SAMPLE_PERIOD_US = 10000;
+
         PinName analogPin; /**< analogPin for the buttons **/
-        std::vector<ButtonSetting> buttonSettings; /**< vector of the struct @{ButtonSetting} **/
+        ButtonSetting buttonSettings[MAX_BUTTONS]; /**< array of the struct @{ButtonSetting} - in any order **/
+        uint16_t samplePeriodUs = DEFAULT_SAMPLE_PERIOD_US; /**< period of the sampling of buttons in microseconds (0 = default) **/
+        uint8_t debounceCount = 3; /**< number of the same consecutive samples for change of the state (including the first changed one) **/
+        uint16_t longPressMs = 800; /**< time of holding the button for @{Event::Type::longPress} **/
+    };
+
+    struct Event {
+        enum class Type {
+            press,
+            release,
+            longPress
+        };
+
+        Type type;
+        ButtonId id;
     };
 
+    static constexpr ButtonId NO_BUTTON = -1;
+    static constexpr int EVENT_QUEUE_SIZE = 8;
+
     /**
      * Constructor of class Buttons.
      *
+     * Start the background sampling of the buttons.
+     *
      * @param config structure @{Config}
      */
     Buttons(const Config& config)
-        : m_config(config)
-        , m_analogIn(config.analogPin){};
+        : m_debounceCount(config.debounceCount)
+        , m_longPressSamples((config.longPressMs * 1000) / samplePeriodUs(config))
+        , m_analogIn(config.analogPin)
+    {
+        for (const auto& button : config.buttonSettings) {
+            if (button.boundaryValue != 0) {
+                m_buttons[m_buttonCount++] = button;
+            }
+        }
+        std::sort(m_buttons.begin(), m_buttons.begin() + m_buttonCount,
+            [](const ButtonSetting& a, const ButtonSetting& b) { return a.boundaryValue < b.boundaryValue; });
+
+        m_ticker.attach_us(callback(this, &Buttons::sample), samplePeriodUs(config));
+    };
 
     /**
-     * Return the id of pressed button.
+     * Return the id of pressed button (debounced).
      *
-     * @return @{ButtonId} type
+     * @return @{ButtonId} type (@{NO_BUTTON} if nothing is pressed)
      */
-    ButtonId getPressed() { return decode(); }
+    ButtonId getPressed() const { return m_pressed; }
 
     /**
      * Return the id of pressed button and save it to parameter buttonId.
@@ -42,9 +82,9 @@ public:
      * @param buttonId variable for saving current value
      * @return @{ButtonId} type
      */
-    ButtonId getPressed(ButtonId& buttonId)
+    ButtonId getPressed(ButtonId& buttonId) const
     {
-        return (buttonId = decode());
+        return (buttonId = getPressed());
     }
 
     /**
@@ -53,42 +93,103 @@ public:
      * @param buttonId id of the button
      * @return true if is pressed, else false
      */
-    bool isPressed(ButtonId buttonId)
+    bool isPressed(ButtonId buttonId) const
+    {
+        return getPressed() == buttonId;
+    }
+
+    /**
+     * Take the oldest event of the buttons.
+     *
+     * @param event variable for saving the event
+     * @return false if there is no event
+     */
+    bool pollEvent(Event& event)
     {
-        return decode() == buttonId;
+        return m_events.pop(event);
     }
 
     /**
      * Wait for press button with specific id.
      *
+     * The processor sleeps between the samples.
+     *
      * @param buttonId id of button on which will wait
      */
     void waitForPress(ButtonId buttonId)
     {
         while (!isPressed(buttonId)) {
-            wait(0.1);
+            sleep();
         }
     }
 
 private:
+    using ButtonSetting = Config::ButtonSetting;
+
+    /**
+     * Get the sampling period - 0 would divide by zero and fire the ticker without pause.
+     */
+    static uint16_t samplePeriodUs(const Config& config)
+    {
+        return config.samplePeriodUs != 0 ? config.samplePeriodUs : Config::DEFAULT_SAMPLE_PERIOD_US;
+    }
+
     /**
-     * Decode the actual state of buttons.
+     * Decode the analog value - binary search in the sorted boundaries.
      *
-     * @return actual pressed buttonId
+     * @return pressed buttonId
      */
-    ButtonId decode()
+    ButtonId decode(uint16_t analogValue) const
     {
-        int analogValue = m_analogIn.read_u16();
-        for (const auto& button : m_config.buttonSettings) {
-            if (analogValue < button.boundaryValue) {
-                return button.id;
+        auto end = m_buttons.begin() + m_buttonCount;
+        auto button = std::upper_bound(m_buttons.begin(), end, analogValue,
+            [](uint16_t value, const ButtonSetting& setting) { return value < setting.boundaryValue; });
+        return button == end ? NO_BUTTON : button->id;
+    }
+
+    /**
+     * Sample and debounce the buttons, generate the events - called by ticker.
+     */
+    void sample()
+    {
+        ButtonId actual = decode(m_analogIn.read_u16());
+        if (actual != m_candidate) {
+            m_candidate = actual;
+            m_candidateCount = 1;
+        } else if (m_candidateCount < m_debounceCount) {
+            m_candidateCount++;
+        }
+        if (m_candidateCount < m_debounceCount) {
+            return;
+        }
+
+        if (m_candidate != m_pressed) {
+            if (m_pressed != NO_BUTTON) {
+                m_events.push({ Event::Type::release, m_pressed });
+            }
+            if (m_candidate != NO_BUTTON) {
+                m_events.push({ Event::Type::press, m_candidate });
             }
+            m_pressed = m_candidate;
+            m_pressedSamples = 0;
+        } else if (m_pressed != NO_BUTTON && ++m_pressedSamples == m_longPressSamples) {
+            m_events.push({ Event::Type::longPress, m_pressed });
         }
-        return -1;
     }
 
-    const Config& m_config;
-    AnalogIn m_analogIn;
+    std::array<ButtonSetting, Config::MAX_BUTTONS> m_buttons;
+    uint8_t m_buttonCount = 0;
+    const uint8_t m_debounceCount;
+    const uint32_t m_longPressSamples;
+
+    InterruptAnalogIn m_analogIn;
+    Ticker m_ticker;
+
+    RingBuffer<Event, EVENT_QUEUE_SIZE> m_events;
+    std::atomic<ButtonId> m_pressed { NO_BUTTON };
+    ButtonId m_candidate = NO_BUTTON;
+    uint8_t m_candidateCount = 0;
+    uint32_t m_pressedSamples = 0;
 };
 
 } // namespace nxpcup
@@ -2,6 +2,7 @@
 
 #include "mbed.h"
 
+#include "Clock.h"
 #include "Image.h"
 #include "util.h"
 
@@ -23,6 +24,20 @@ public:
         static constexpr uint32_t EXPOSURE_TIME_MAX = 150000;
     };
 
+    /**
+     * Per-pixel correction of the fixed-pattern offset (dark frame) and vignetting (flat frame).
+     *
+     * corrected = (raw - offset) * gain / GAIN_ONE
+     */
+    struct Calibration {
+        static constexpr int GAIN_SHIFT = 12;
+        static constexpr uint16_t GAIN_ONE = 1 << GAIN_SHIFT;
+
+        std::array<uint16_t, ImageSize> offset; /**< value of the pixel without light **/
+        std::array<uint16_t, ImageSize> gain; /**< gain of the pixel (@{GAIN_ONE} = 1.0) **/
+        bool isValid = false; /**< correction is applied only for valid calibration **/
+    };
+
     /**
      * Constructor of class Camera.
      *
@@ -91,6 +106,73 @@ public:
         return m_image.data;
     }
 
+    /**
+     * Capture the dark frame - the camera must be covered.
+     *
+     * Resets the gain, call @{captureFlat()} afterwards.
+     *
+     * @param calibration struct @{Calibration} for the result
+     * @param frames number of averaged images (at least 1)
+     */
+    void captureDark(Calibration& calibration, int frames = 8)
+    {
+        frames = std::max(frames, 1);
+        std::array<uint32_t, ImageSize> sum = {};
+        captureAverage(sum, frames);
+        for (int i = 0; i < ImageSize; i++) {
+            calibration.offset[i] = sum[i] / frames;
+            calibration.gain[i] = Calibration::GAIN_ONE;
+        }
+        calibration.isValid = true;
+    }
+
+    /**
+     * Capture the flat frame - the camera must see uniform light surface.
+     *
+     * The gain equalizes all pixels to the brightest one.
+     *
+     * @param calibration struct @{Calibration} for the result (offset from @{captureDark()} is kept)
+     * @param frames number of averaged images (at least 1)
+     */
+    void captureFlat(Calibration& calibration, int frames = 8)
+    {
+        frames = std::max(frames, 1);
+        std::array<uint32_t, ImageSize> sum = {};
+        captureAverage(sum, frames);
+        uint32_t brightest = 1;
+        for (int i = 0; i < ImageSize; i++) {
+            int32_t offset = calibration.isValid ? calibration.offset[i] : 0;
+            sum[i] = std::max<int32_t>(int32_t(sum[i] / frames) - offset, 1);
+            brightest = std::max(brightest, sum[i]);
+        }
+        for (int i = 0; i < ImageSize; i++) {
+            calibration.gain[i] = std::min<uint32_t>((brightest << Calibration::GAIN_SHIFT) / sum[i], UINT16_MAX);
+        }
+        if (!calibration.isValid) {
+            calibration.offset.fill(0);
+        }
+        calibration.isValid = true;
+    }
+
+    /**
+     * Get the used calibration (nullptr = without correction).
+     */
+    const Calibration* calibration() const { return m_calibration; }
+
+    /**
+     * Set the calibration applied to the images.
+     *
+     * The calibration is not copied - the camera without calibration doesn't need memory for it.
+     *
+     * @param calibration struct @{Calibration} (must exist while it is used, nullptr = without correction)
+     */
+    void setCalibration(const Calibration* calibration) { m_calibration = calibration; }
+
+    /**
+     * Turn off the correction of the image.
+     */
+    void resetCalibration() { m_calibration = nullptr; }
+
     /**
      * Update the data from camera with exact exposition.
      *
@@ -109,13 +191,15 @@ public:
             m_clk.write(true);
         }
         m_clk.write(false);
-        wait_us(m_expositionUs);
+        systemClock().waitUs(m_expositionUs);
         updateImage();
     }
 
 protected:
     /**
      * Update the data from camera immediate (without set exposition).
+     *
+     * The calibration is applied during the reading.
      */
     void updateImage()
     {
@@ -123,20 +207,51 @@ protected:
         m_clk.write(true);
         m_si.write(false);
 
-        for (std::size_t j = 0; j < CameraImage::size; j++) {
-            m_image[j] = m_analogOut.read_u16();
-            m_clk.write(false);
-            m_clk.write(true);
+        if (m_calibration && m_calibration->isValid) {
+            for (std::size_t j = 0; j < CameraImage::size; j++) {
+                int32_t value = int32_t(m_analogOut.read_u16()) - m_calibration->offset[j];
+                m_clk.write(false);
+                m_clk.write(true);
+                // 16-bit value * 16-bit gain fits in uint32_t
+                uint32_t corrected = value < 0 ? 0 : (uint32_t(value) * m_calibration->gain[j]) >> Calibration::GAIN_SHIFT;
+                m_image[j] = std::min<uint32_t>(corrected, UINT16_MAX);
+            }
+        } else {
+            for (std::size_t j = 0; j < CameraImage::size; j++) {
+                m_image[j] = m_analogOut.read_u16();
+                m_clk.write(false);
+                m_clk.write(true);
+            }
         }
         m_clk.write(false);
     }
 
+    /**
+     * Sum the raw images (without calibration).
+     *
+     * @param sum array for the result
+     * @param frames number of images
+     */
+    void captureAverage(std::array<uint32_t, ImageSize>& sum, int frames)
+    {
+        const Calibration* calibration = m_calibration;
+        m_calibration = nullptr;
+        for (int frame = 0; frame < frames; frame++) {
+            update();
+            for (int i = 0; i < ImageSize; i++) {
+                sum[i] += m_image[i];
+            }
+        }
+        m_calibration = calibration;
+    }
+
     AnalogIn m_analogOut; /**< Read the analog data from camera */
     DigitalOut m_clk;
     DigitalOut m_si;
 
     CameraImage m_image;
     uint32_t m_expositionUs = 10000;
+    const Calibration* m_calibration = nullptr;
 };
 
 } // namespace nxpcup
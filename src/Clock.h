@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "mbed.h"
+
+namespace nxpcup {
+
+/**
+ * Monotonic time base of the library (64-bit microseconds - no overflow in practice).
+ *
+ * Classes which measure the time between the calls from the main loop use @{systemClock()}:
+ * @{Encoder}, @{MotorControl}, @{SteeringControl}, @{StateEstimator} and @{SystemIdentification}
+ * (@{Camera} and @{SoftPWM} wait by it). It could be replaced by @{FakeClock} for the simulation
+ * on the host (faster than real time).
+ *
+ * The background sampling runs in the interrupts of the mbed Ticker with fixed period
+ * and is not driven by this clock: @{Servo} slew limit, @{ObstacleDetectorWithServo} scanning,
+ * @{Buttons} and @{Battery}. Their period is in the configuration (e.g. @{Buttons::Config::samplePeriodUs}).
+ */
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    /**
+     * Get the time from the start in microseconds.
+     */
+    virtual uint64_t nowUs() = 0;
+
+    /**
+     * Wait for the time.
+     *
+     * @param us time in microseconds
+     */
+    virtual void waitUs(uint64_t us) = 0;
+
+    /**
+     * Get the time from the previous time stamp and update the time stamp.
+     *
+     * @param lastUs time stamp from previous call (updated to the actual time)
+     * @return elapsed time in microseconds
+     */
+    uint64_t elapsedUs(uint64_t& lastUs)
+    {
+        uint64_t now = nowUs();
+        uint64_t elapsed = now - lastUs;
+        lastUs = now;
+        return elapsed;
+    }
+};
+
+/**
+ * Clock of the microcontroller - 32-bit us ticker extended to 64 bits.
+ *
+ * The time must be read at least once per 71 minutes (one overflow of the ticker).
+ */
+class MbedClock : public Clock {
+public:
+    uint64_t nowUs() override
+    {
+        core_util_critical_section_enter();
+        uint32_t now = us_ticker_read();
+        if (now < m_last) {
+            m_high += uint64_t(1) << 32;
+        }
+        m_last = now;
+        uint64_t result = m_high | now;
+        core_util_critical_section_exit();
+        return result;
+    }
+
+    void waitUs(uint64_t us) override
+    {
+        while (us > 0) {
+            uint32_t step = std::min<uint64_t>(us, 1000000000);
+            wait_us(step);
+            us -= step;
+        }
+    }
+
+private:
+    uint32_t m_last = 0;
+    uint64_t m_high = 0;
+};
+
+/**
+ * Clock for the simulation - the time moves only by @{advance()} and @{waitUs()}.
+ */
+class FakeClock : public Clock {
+public:
+    uint64_t nowUs() override { return m_now; }
+
+    void waitUs(uint64_t us) override { m_now += us; }
+
+    /**
+     * Move the time forward.
+     *
+     * @param us time in microseconds
+     */
+    void advance(uint64_t us) { m_now += us; }
+
+private:
+    uint64_t m_now = 0;
+};
+
+namespace detail {
+    inline Clock*& clockInstance()
+    {
+        static MbedClock mbedClock;
+        static Clock* instance = &mbedClock;
+        return instance;
+    }
+} // namespace detail
+
+/**
+ * Get the clock used by the library (@{MbedClock} by default).
+ */
+inline Clock& systemClock()
+{
+    return *detail::clockInstance();
+}
+
+/**
+ * Replace the clock used by the library (e.g. by @{FakeClock} in the simulation).
+ *
+ * Set it before construction of the other classes - they take the time stamp in the constructor.
+ *
+ * @param clock new clock (must exist during the whole program)
+ */
+inline void setSystemClock(Clock& clock)
+{
+    detail::clockInstance() = &clock;
+}
+
+} // namespace nxpcup
@@ -0,0 +1,521 @@
+#pragma once
+
+// Header file with command channel for tuning of the parameters over the serial line
+//
+// Packet (Lorris format with CRC): 0x80, command, length, data[length], CRC-8 (polynomial 0x07)
+// of the command, length and data. The integers are big endian, float has native byte order
+// (same as the logging functions in Log.h).
+//
+// Commands to the car:
+// - 0x20 set parameter: id, value (4 bytes) -> reply 0x22
+// - 0x21 get parameter: id -> reply 0x22
+// - 0x23 list parameters -> reply 0x24 for every parameter
+// Replies from the car:
+// - 0x22 parameter value: id, type, value (4 bytes)
+// - 0x24 parameter info: id, type, name
+// - 0x2F error: code of @{Error}, command
+//
+// The host tool is tools/nxpcup-tune.py (list, get, set and interactive shell).
+//
+//     RawSerial bluetooth(BLUETOOTH.TX, BLUETOOTH.RX, 115200);
+//     nxpcup::ConfigBinding<nxpcup::MotorControl> motorBinding(motorControl);
+//     nxpcup::CommandChannel channel(bluetooth);
+//     channel.add("motor.p", motorBinding, motorBinding.config().coefficientP);
+//     while (true) {
+//         ... // control cycle
+//         sendDetectorDataLorris(channel, detector); // logging shares the link with the replies
+//         channel.poll(); // the changes are applied here by setConfig()
+//     }
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "mbed.h"
+
+#include "Atomic.h"
+#include "RingBuffer.h"
+
+namespace nxpcup {
+
+/**
+ * Copy of the configuration which is applied to the target by setConfig().
+ */
+class ConfigBindingBase {
+public:
+    virtual ~ConfigBindingBase() = default;
+
+    /**
+     * Apply the copy of the configuration to the target.
+     */
+    virtual void apply() = 0;
+
+    bool isChanged = false;
+};
+
+/**
+ * Copy of the configuration of the target (e.g. @{MotorControl}, @{SteeringControl}).
+ *
+ * @tparam Target class with Config, config() and setConfig()
+ */
+template <typename Target>
+class ConfigBinding : public ConfigBindingBase {
+public:
+    using Config = typename Target::Config;
+
+    /**
+     * Constructor of class ConfigBinding.
+     *
+     * @param target object with the configuration (the actual configuration is copied)
+     */
+    ConfigBinding(Target& target)
+        : m_target(target)
+        , m_config(target.config())
+    {
+    }
+
+    /**
+     * Get the copy of the configuration - the parameters are registered from it.
+     */
+    Config& config() { return m_config; }
+
+    void apply() override { m_target.setConfig(m_config); }
+
+private:
+    Target& m_target;
+    Config m_config;
+};
+
+/**
+ * Command channel for reading and setting of the parameters.
+ *
+ * The packets are parsed in the RX interrupt and queued, the commands are processed
+ * and the changed configurations applied in @{poll()} - between the control cycles.
+ * The replies and the logging (@{putc()}) are queued and sent by the TX interrupt,
+ * so @{poll()} never waits for the serial line.
+ *
+ * @tparam SerialType serial line with getc() usable in the interrupt (Serial locks mutex on mbed OS 5)
+ */
+template <typename SerialType = RawSerial>
+class BasicCommandChannel {
+public:
+    enum class Type : uint8_t {
+        boolean,
+        int8,
+        uint8,
+        int16,
+        uint16,
+        int32,
+        uint32,
+        float32
+    };
+
+    enum class Error : uint8_t {
+        unknownCommand = 1,
+        unknownParameter = 2,
+        badLength = 3
+    };
+
+    static constexpr uint8_t HEADER = 0x80;
+    static constexpr uint8_t SET_PARAMETER = 0x20;
+    static constexpr uint8_t GET_PARAMETER = 0x21;
+    static constexpr uint8_t PARAMETER_VALUE = 0x22;
+    static constexpr uint8_t LIST_PARAMETERS = 0x23;
+    static constexpr uint8_t PARAMETER_INFO = 0x24;
+    static constexpr uint8_t ERROR_REPLY = 0x2F;
+
+    static constexpr int MAX_PARAMETERS = 32;
+    static constexpr int MAX_DATA = 32;
+    static constexpr int QUEUE_SIZE = 4;
+    static constexpr int TRANSMIT_QUEUE_SIZE = 128;
+    static constexpr int MAX_PACKET = MAX_DATA + 4; // header, command, length and CRC
+
+    /**
+     * Constructor of class BasicCommandChannel.
+     *
+     * Start receiving in the RX interrupt.
+     *
+     * @param serial line for the commands and replies
+     */
+    BasicCommandChannel(SerialType& serial)
+        : m_serial(serial)
+    {
+        m_serial.attach(callback(this, &BasicCommandChannel::receive), SerialType::RxIrq);
+    }
+
+    /**
+     * Register the parameter.
+     *
+     * @param name of the parameter for the host (must exist during the whole program)
+     * @param binding configuration which contains the parameter
+     * @param field the parameter in @{ConfigBinding::config()}
+     * @return false if there is no space for the parameter (@{MAX_PARAMETERS})
+     */
+    template <typename Field>
+    bool add(const char* name, ConfigBindingBase& binding, Field& field)
+    {
+        if (m_parameterCount == MAX_PARAMETERS) {
+            return false;
+        }
+        bool isListFinished = m_listIndex == m_parameterCount;
+        m_parameters[m_parameterCount++] = { name, typeOf<Field>(), &field, &binding };
+        if (isListFinished) {
+            m_listIndex = m_parameterCount;
+        }
+        return true;
+    }
+
+    /**
+     * Process the received commands and apply the changed configurations.
+     *
+     * Call it between the control cycles - all changes received since the last call
+     * are applied together. The commands whose replies don't fit in the transmit queue
+     * wait for the next call (the list of parameters is sent during several calls).
+     */
+    void poll()
+    {
+        Packet packet;
+        while (m_listIndex < m_parameterCount && transmitSpace() >= MAX_PACKET) {
+            sendInfo(m_listIndex++);
+        }
+        while (m_listIndex == m_parameterCount && transmitSpace() >= MAX_PACKET && m_packets.pop(packet)) {
+            process(packet);
+        }
+        for (int i = 0; i < m_parameterCount; i++) {
+            ConfigBindingBase& binding = *m_parameters[i].binding;
+            if (binding.isChanged) {
+                binding.apply();
+                binding.isChanged = false;
+            }
+        }
+    }
+
+    /**
+     * Send one byte through the transmit queue - for the logging functions in Log.h.
+     *
+     * Waits only when the transmit queue is full.
+     *
+     * @param c byte for sending
+     */
+    int putc(int c)
+    {
+        while (!m_transmitQueue.push(c)) {
+            startTransmit();
+        }
+        startTransmit();
+        return c;
+    }
+
+    /**
+     * Get the number of packets with wrong CRC.
+     */
+    uint32_t crcErrors() const { return m_crcErrors.total(); }
+
+    /**
+     * Get the number of packets dropped due to full queue (@{poll()} is not called often enough).
+     */
+    uint32_t droppedPackets() const { return m_droppedPackets.total(); }
+
+private:
+    struct Parameter {
+        const char* name;
+        Type type;
+        void* value;
+        ConfigBindingBase* binding;
+    };
+
+    struct Packet {
+        uint8_t command;
+        uint8_t length;
+        uint8_t data[MAX_DATA];
+    };
+
+    enum class State {
+        header,
+        command,
+        length,
+        data,
+        crc
+    };
+
+    template <typename Field>
+    static constexpr Type typeOf()
+    {
+        if constexpr (std::is_same<Field, bool>::value) {
+            return Type::boolean;
+        } else if constexpr (std::is_same<Field, int8_t>::value) {
+            return Type::int8;
+        } else if constexpr (std::is_same<Field, uint8_t>::value) {
+            return Type::uint8;
+        } else if constexpr (std::is_same<Field, int16_t>::value) {
+            return Type::int16;
+        } else if constexpr (std::is_same<Field, uint16_t>::value) {
+            return Type::uint16;
+        } else if constexpr (std::is_integral<Field>::value && std::is_signed<Field>::value && sizeof(Field) == 4) {
+            return Type::int32;
+        } else if constexpr (std::is_integral<Field>::value && sizeof(Field) == 4) {
+            return Type::uint32;
+        } else {
+            static_assert(std::is_same<Field, float>::value, "unsupported type of the parameter");
+            return Type::float32;
+        }
+    }
+
+    /**
+     * Send the queued bytes - called by TX interrupt, stops itself when the queue is empty.
+     */
+    void transmit()
+    {
+        uint8_t byte;
+        while (m_serial.writeable()) {
+            if (!m_transmitQueue.pop(byte)) {
+                m_isTransmitting.store(false);
+                m_serial.attach(Callback<void()>(), SerialType::TxIrq);
+                return;
+            }
+            m_serial.putc(byte);
+        }
+    }
+
+    void startTransmit()
+    {
+        // only load and store (Cortex-M0+) - the interrupt clears the flag only with empty queue
+        if (!m_isTransmitting.load()) {
+            m_isTransmitting.store(true);
+            m_serial.attach(callback(this, &BasicCommandChannel::transmit), SerialType::TxIrq);
+        }
+    }
+
+    int transmitSpace() const { return m_transmitQueue.capacity() - m_transmitQueue.size(); }
+
+    /**
+     * Read the received bytes - called by RX interrupt.
+     */
+    void receive()
+    {
+        while (m_serial.readable()) {
+            parse(m_serial.getc());
+        }
+    }
+
+    /**
+     * Parse one byte of the packet, complete packets with correct CRC are queued.
+     */
+    void parse(uint8_t byte)
+    {
+        switch (m_state) {
+        case State::header:
+            if (byte == HEADER) {
+                m_state = State::command;
+            }
+            break;
+        case State::command:
+            m_receivedPacket.command = byte;
+            m_crc = crc8(0, byte);
+            m_state = State::length;
+            break;
+        case State::length:
+            if (byte > MAX_DATA) {
+                m_state = State::header;
+                break;
+            }
+            m_receivedPacket.length = byte;
+            m_crc = crc8(m_crc, byte);
+            m_receivedLength = 0;
+            m_state = byte == 0 ? State::crc : State::data;
+            break;
+        case State::data:
+            m_receivedPacket.data[m_receivedLength++] = byte;
+            m_crc = crc8(m_crc, byte);
+            if (m_receivedLength == m_receivedPacket.length) {
+                m_state = State::crc;
+            }
+            break;
+        case State::crc:
+            if (byte != m_crc) {
+                m_crcErrors.increment();
+            } else if (!m_packets.push(m_receivedPacket)) {
+                m_droppedPackets.increment();
+            }
+            m_state = State::header;
+            break;
+        }
+    }
+
+    void process(const Packet& packet)
+    {
+        switch (packet.command) {
+        case SET_PARAMETER:
+            if (packet.length != 5) {
+                sendError(Error::badLength, packet.command);
+            } else if (packet.data[0] >= m_parameterCount) {
+                sendError(Error::unknownParameter, packet.command);
+            } else {
+                write(m_parameters[packet.data[0]], packet.data + 1);
+                m_parameters[packet.data[0]].binding->isChanged = true;
+                sendValue(packet.data[0]);
+            }
+            break;
+        case GET_PARAMETER:
+            if (packet.length != 1) {
+                sendError(Error::badLength, packet.command);
+            } else if (packet.data[0] >= m_parameterCount) {
+                sendError(Error::unknownParameter, packet.command);
+            } else {
+                sendValue(packet.data[0]);
+            }
+            break;
+        case LIST_PARAMETERS:
+            m_listIndex = 0; // sent by poll()
+            break;
+        default:
+            sendError(Error::unknownCommand, packet.command);
+            break;
+        }
+    }
+
+    /**
+     * Write the value from the packet to the parameter.
+     */
+    static void write(const Parameter& parameter, const uint8_t* data)
+    {
+        int32_t integer = (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+        switch (parameter.type) {
+        case Type::boolean:
+            *static_cast<bool*>(parameter.value) = integer != 0;
+            break;
+        case Type::int8:
+            *static_cast<int8_t*>(parameter.value) = integer;
+            break;
+        case Type::uint8:
+            *static_cast<uint8_t*>(parameter.value) = integer;
+            break;
+        case Type::int16:
+            *static_cast<int16_t*>(parameter.value) = integer;
+            break;
+        case Type::uint16:
+            *static_cast<uint16_t*>(parameter.value) = integer;
+            break;
+        case Type::int32:
+        case Type::uint32:
+            memcpy(parameter.value, &integer, 4);
+            break;
+        case Type::float32:
+            memcpy(parameter.value, data, 4);
+            break;
+        }
+    }
+
+    /**
+     * Read the value of the parameter in the format of the packet.
+     */
+    static void read(const Parameter& parameter, uint8_t* data)
+    {
+        int32_t integer = 0;
+        switch (parameter.type) {
+        case Type::boolean:
+            integer = *static_cast<bool*>(parameter.value);
+            break;
+        case Type::int8:
+            integer = *static_cast<int8_t*>(parameter.value);
+            break;
+        case Type::uint8:
+            integer = *static_cast<uint8_t*>(parameter.value);
+            break;
+        case Type::int16:
+            integer = *static_cast<int16_t*>(parameter.value);
+            break;
+        case Type::uint16:
+            integer = *static_cast<uint16_t*>(parameter.value);
+            break;
+        case Type::int32:
+        case Type::uint32:
+            memcpy(&integer, parameter.value, 4);
+            break;
+        case Type::float32:
+            memcpy(data, parameter.value, 4);
+            return;
+        }
+        data[0] = integer >> 24;
+        data[1] = integer >> 16;
+        data[2] = integer >> 8;
+        data[3] = integer;
+    }
+
+    void sendValue(uint8_t id)
+    {
+        uint8_t data[6] = { id, uint8_t(m_parameters[id].type) };
+        read(m_parameters[id], data + 2);
+        sendPacket(PARAMETER_VALUE, data, sizeof(data));
+    }
+
+    void sendInfo(uint8_t id)
+    {
+        uint8_t data[MAX_DATA] = { id, uint8_t(m_parameters[id].type) };
+        uint8_t length = strnlen(m_parameters[id].name, MAX_DATA - 2);
+        memcpy(data + 2, m_parameters[id].name, length);
+        sendPacket(PARAMETER_INFO, data, length + 2);
+    }
+
+    void sendError(Error error, uint8_t command)
+    {
+        uint8_t data[2] = { uint8_t(error), command };
+        sendPacket(ERROR_REPLY, data, sizeof(data));
+    }
+
+    /**
+     * Queue the packet - there must be space for @{MAX_PACKET} bytes.
+     */
+    void sendPacket(uint8_t command, const uint8_t* data, uint8_t length)
+    {
+        m_transmitQueue.push(HEADER);
+        m_transmitQueue.push(command);
+        m_transmitQueue.push(length);
+        uint8_t crc = crc8(crc8(0, command), length);
+        for (int i = 0; i < length; i++) {
+            m_transmitQueue.push(data[i]);
+            crc = crc8(crc, data[i]);
+        }
+        m_transmitQueue.push(crc);
+        startTransmit();
+    }
+
+    /**
+     * Add one byte to CRC-8 (polynomial 0x07).
+     */
+    static uint8_t crc8(uint8_t crc, uint8_t byte)
+    {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+        return crc;
+    }
+
+    SerialType& m_serial;
+
+    Parameter m_parameters[MAX_PARAMETERS];
+    int m_parameterCount = 0;
+    int m_listIndex = 0; // next parameter for the list reply (m_parameterCount = finished)
+
+    // owned by the interrupt
+    State m_state = State::header;
+    Packet m_receivedPacket;
+    uint8_t m_receivedLength = 0;
+    uint8_t m_crc = 0;
+
+    RingBuffer<Packet, QUEUE_SIZE> m_packets;
+    MonotonicCounter m_crcErrors;
+    MonotonicCounter m_droppedPackets;
+
+    RingBuffer<uint8_t, TRANSMIT_QUEUE_SIZE> m_transmitQueue;
+    std::atomic<bool> m_isTransmitting { false };
+};
+
+/**
+ * Command channel on the RawSerial line.
+ */
+using CommandChannel = BasicCommandChannel<>;
+
+} // namespace nxpcup
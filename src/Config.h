@@ -9,6 +9,7 @@
 #include "ObstacleDetector.h"
 #include "ObstacleDetectorWithServo.h"
 #include "SoftPWM.h"
+#include "SteeringControl.h"
 #include "atoms/control/pid.h"
 
 #if !(defined MOTOR_HARDWARE_PWM || defined MOTOR_SOFTWARE_PWM)
@@ -82,6 +83,8 @@ namespace alamak {
 
             detail::Bluetooth BLUETOOTH{ PTE22, PTE23 }; // TX, RX
 
+            // nxpcup::Battery::Config BATTERY{ PTxx }; // analog in pin with divided battery voltage - not connected on the board
+
             nxpcup::Encoder::Config ENCODER_LEFT{
                 PTD4, // pin with interrupt
                 400 // pulsePerRevolution
@@ -99,6 +102,11 @@ namespace alamak {
                 90 // maximal value
             };
 
+            nxpcup::SteeringControl::Config STEERING_CONTROL{
+                STEERING_PID_CONFIG, // PID constants
+                0 // plant gain - 0 = without delay compensation (set from SteeringIdentification)
+            };
+
             static constexpr uint8_t LORISS_SEND_PERIOD_MS = 150;
 
         } // namespace config
@@ -157,6 +165,8 @@ namespace alamak {
 
             detail::Bluetooth BLUETOOTH{ PTC4, PTC3 }; // { TX, RX }
 
+            // nxpcup::Battery::Config BATTERY{ PTxx }; // analog in pin with divided battery voltage - not connected on the board
+
             nxpcup::Encoder::Config ENCODER_LEFT{
                 PTC16, // pin with interrupt
                 400 // pulsePerRevolution
@@ -174,6 +184,11 @@ namespace alamak {
                 90 // maximal value
             };
 
+            nxpcup::SteeringControl::Config STEERING_CONTROL{
+                STEERING_PID_CONFIG, // PID constants
+                0 // plant gain - 0 = without delay compensation (set from SteeringIdentification)
+            };
+
             constexpr int LORISS_SEND_PERIOD_MS = 150;
 
         } // namespace config
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Conversion of raw values from IR distance sensor to millimetres.
+ *
+ * Piecewise-linear table of calibration points (raw value, distance)
+ * with precomputed slopes in fixed point - one search and one multiply per conversion.
+ * The default table is for Sharp GP2Y0A21 (10 - 80 cm) read by read_u16().
+ */
+class DistanceCalibration {
+public:
+    static constexpr int MAX_POINTS = 8;
+    static constexpr int SLOPE_SHIFT = 16; // fixed point of the slope
+
+    struct Point {
+        uint16_t raw; /**< raw value from sensor **/
+        uint16_t distanceMm; /**< distance in millimetres **/
+    };
+
+    struct Config {
+        uint8_t count = 7; /**< number of valid points **/
+        std::array<Point, MAX_POINTS> points = { { { 26000, 100 },
+            { 20000, 150 },
+            { 15500, 200 },
+            { 10000, 300 },
+            { 7800, 400 },
+            { 5500, 600 },
+            { 4300, 800 } } }; /**< points sorted by decreasing raw value (increasing distance) **/
+    };
+
+    /**
+     * Constructor of class DistanceCalibration.
+     *
+     * @param config struct @{Config}
+     */
+    DistanceCalibration(Config config)
+    {
+        setConfig(config);
+    }
+
+    /**
+     * Convert raw value to distance.
+     *
+     * @param raw value from sensor
+     * @return distance in millimetres - clamped to the range of the table
+     */
+    uint16_t toMillimeters(uint16_t raw) const
+    {
+        const auto& points = m_config.points;
+        if (m_config.count == 0) {
+            return 0;
+        }
+        if (raw >= points[0].raw) {
+            return points[0].distanceMm;
+        }
+        int last = m_config.count - 1;
+        if (raw <= points[last].raw) {
+            return points[last].distanceMm;
+        }
+        int low = 0;
+        int high = last;
+        while (high - low > 1) {
+            int middle = (low + high) / 2;
+            if (points[middle].raw > raw) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        int32_t offset = points[low].raw - raw;
+        return points[low].distanceMm + ((offset * m_slopes[low]) >> SLOPE_SHIFT);
+    }
+
+    /**
+     * Convert distance to raw value - for thresholds in raw values.
+     *
+     * @param distanceMm distance in millimetres
+     * @return raw value from sensor - clamped to the range of the table
+     */
+    uint16_t toRaw(uint16_t distanceMm) const
+    {
+        const auto& points = m_config.points;
+        if (m_config.count == 0) {
+            return 0;
+        }
+        if (distanceMm <= points[0].distanceMm) {
+            return points[0].raw;
+        }
+        for (int i = 1; i < m_config.count; i++) {
+            if (distanceMm <= points[i].distanceMm) {
+                int32_t rawDiff = points[i - 1].raw - points[i].raw;
+                int32_t distanceDiff = points[i].distanceMm - points[i - 1].distanceMm;
+                return points[i - 1].raw - (rawDiff * (distanceMm - points[i - 1].distanceMm)) / distanceDiff;
+            }
+        }
+        return points[m_config.count - 1].raw;
+    }
+
+    /**
+     * Add measured calibration point (obstacle in known distance).
+     *
+     * The point replaces the one with the same distance, else it is inserted
+     * to keep the order. If the table is full or the raw value doesn't decrease
+     * with the distance (the conversion searches by the raw value), the point is ignored.
+     *
+     * @param distanceMm distance of the obstacle in millimetres
+     * @param raw value from sensor (e.g. averaged by @{SensorFilter})
+     * @return true if the point was saved
+     */
+    bool capture(uint16_t distanceMm, uint16_t raw)
+    {
+        auto& points = m_config.points;
+        int index = 0;
+        while (index < m_config.count && points[index].distanceMm < distanceMm) {
+            index++;
+        }
+        bool isReplaced = index < m_config.count && points[index].distanceMm == distanceMm;
+        int next = isReplaced ? index + 1 : index;
+        if ((index > 0 && raw >= points[index - 1].raw)
+            || (next < m_config.count && raw <= points[next].raw)) {
+            return false;
+        }
+        if (isReplaced) {
+            points[index].raw = raw;
+        } else {
+            if (m_config.count == MAX_POINTS) {
+                return false;
+            }
+            for (int i = m_config.count; i > index; i--) {
+                points[i] = points[i - 1];
+            }
+            points[index] = { raw, distanceMm };
+            m_config.count++;
+        }
+        updateSlopes();
+        return true;
+    }
+
+    /**
+     * Remove all calibration points - prepare for @{capture()}.
+     */
+    void clear()
+    {
+        m_config.count = 0;
+    }
+
+    /**
+     * Get the actual configuration of the @{DistanceCalibration}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{DistanceCalibration}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(const Config& config)
+    {
+        m_config = config;
+        m_config.count = nxpcup::clamp<uint8_t>(m_config.count, 0, MAX_POINTS);
+        updateSlopes();
+    }
+
+private:
+    /**
+     * Precompute the slopes between neighboring points.
+     */
+    void updateSlopes()
+    {
+        for (int i = 0; i + 1 < m_config.count; i++) {
+            int32_t rawDiff = m_config.points[i].raw - m_config.points[i + 1].raw;
+            int32_t distanceDiff = m_config.points[i + 1].distanceMm - m_config.points[i].distanceMm;
+            m_slopes[i] = rawDiff > 0 ? (distanceDiff << SLOPE_SHIFT) / rawDiff : 0;
+        }
+    }
+
+    Config m_config;
+    std::array<int32_t, MAX_POINTS> m_slopes = {};
+};
+
+} // namespace nxpcup
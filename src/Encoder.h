@@ -2,6 +2,9 @@
 
 #include "mbed.h"
 
+#include "Atomic.h"
+#include "Clock.h"
+
 namespace nxpcup {
 
 class Encoder {
@@ -21,6 +24,7 @@ public:
     Encoder(Config config)
         : m_config(config)
         , m_interrupt(config.pin)
+        , m_lastUpdateUs(systemClock().nowUs())
     {
         m_interrupt.rise(callback(this, &Encoder::increment));
 
@@ -32,16 +36,25 @@ public:
     /**
      * Update speed and distance.
      *
-     * @param timeSinceLastCallUs time in microseconds from last call this function (NOT USED)
+     * The time from the last call is measured by @{systemClock()}.
+     *
      * @return velocity in [m/s]
      */
-    float update(uint16_t timeSinceLastCallUs)
+    float update()
     {
-        m_speed = (1000.0 * m_config.wheelCircumference * m_count) / (m_config.pulsePerRevolution * m_config.gearRatio * timeSinceLastCallUs);
-        m_distanceCount += m_count;
-        m_count = 0;
+        return updateSpeed(systemClock().elapsedUs(m_lastUpdateUs));
+    }
 
-        return m_speed;
+    /**
+     * Update speed and distance.
+     *
+     * @param timeSinceLastCallUs time in microseconds from last call this function
+     * @return velocity in [m/s]
+     */
+    [[deprecated("use update() - the time is measured by systemClock()")]] float update(uint16_t timeSinceLastCallUs)
+    {
+        m_lastUpdateUs = systemClock().nowUs();
+        return updateSpeed(timeSinceLastCallUs);
     }
 
     /**
@@ -72,15 +85,31 @@ public:
 
 private:
     /**
-     * Increment the internal variable m_count.
+     * Calculate the speed from the pulses counted during the elapsed time.
+     */
+    float updateSpeed(uint64_t elapsedUs)
+    {
+        if (elapsedUs == 0) {
+            return m_speed;
+        }
+        uint32_t count = m_pulses.take();
+        m_speed = (1000.0 * m_config.wheelCircumference * count) / (m_config.pulsePerRevolution * m_config.gearRatio * elapsedUs);
+        m_distanceCount += count;
+
+        return m_speed;
+    }
+
+    /**
+     * Count the pulse - called by interrupt.
      */
-    void increment() { m_count++; }
+    void increment() { m_pulses.increment(); }
 
     Config m_config;
     InterruptIn m_interrupt;
-    volatile uint16_t m_count = 0;
+    MonotonicCounter m_pulses;
     float m_speed = 0;
     long m_distanceCount = 0;
+    uint64_t m_lastUpdateUs;
 };
 
 } // namespace nxpcup
@@ -34,12 +34,25 @@ struct Image {
      */
     Image difference() const
     {
-        std::array<T, size> res;
-        res[0] = 0;
+        Image res;
+        difference(res);
+        return res;
+    }
+
+    /**
+     * Differentiate the image without temporary copy.
+     *
+     * @param result image for the result (could be this image)
+     */
+    void difference(Image& result) const
+    {
+        T previous = data[0];
+        result[0] = 0;
         for (std::size_t i = 1; i < data.size(); i++) {
-            res[i] = abs(data[i] - data[i - 1]);
+            T actual = data[i];
+            result[i] = abs(actual - previous);
+            previous = actual;
         }
-        return Image{ res };
     }
 };
 
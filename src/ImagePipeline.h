@@ -0,0 +1,335 @@
+#pragma once
+
+// Header file with lazy pipeline over the @{Image}
+//
+// The stages are composed in compile time and evaluated in one loop
+// without temporary images - e.g.:
+//
+//     auto index = pipeline::from(camera.image()).smooth().difference().abs().threshold(500).argmax();
+//
+// The pipeline is evaluated by the terminal operation (@{Stage::materialize()},
+// @{Stage::reduce()}, @{Stage::argmax()}) - every terminal operation reads the image again.
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "Image.h"
+
+namespace nxpcup {
+namespace pipeline {
+
+    template <typename Source>
+    class Calibrate;
+    template <typename Source>
+    class Smooth;
+    template <typename Source>
+    class Difference;
+    template <typename Source>
+    class Abs;
+    template <typename Source>
+    class Threshold;
+
+    /**
+     * Base of all stages - composition of the stages and terminal operations.
+     *
+     * Every stage has value_type, size and next() which returns the next pixel.
+     */
+    template <typename Derived>
+    class Stage {
+    public:
+        /**
+         * Per-pixel correction (raw - offset) * gain >> GAIN_SHIFT.
+         *
+         * @param calibration struct with offset, gain, GAIN_SHIFT and isValid (e.g. @{Camera::Calibration})
+         */
+        template <typename Calibration>
+        Calibrate<Derived> calibrate(const Calibration& calibration) const
+        {
+            return { derived(), calibration.offset.data(), calibration.gain.data(), Calibration::GAIN_SHIFT, calibration.isValid };
+        }
+
+        /**
+         * Smoothing with kernel [1 2 1] / 4 (the border pixels are repeated).
+         */
+        Smooth<Derived> smooth() const { return { derived() }; }
+
+        /**
+         * Signed difference between neighboring pixels (the first pixel is 0).
+         */
+        Difference<Derived> difference() const { return { derived() }; }
+
+        /**
+         * Absolute value of the pixels.
+         */
+        Abs<Derived> abs() const { return { derived() }; }
+
+        /**
+         * Pixels smaller than the limit are set to 0, the others are kept.
+         *
+         * @param limit minimal kept value
+         */
+        template <typename U>
+        Threshold<Derived> threshold(U limit) const
+        {
+            return { derived(), typename Threshold<Derived>::value_type(limit) };
+        }
+
+        /**
+         * Evaluate the pipeline into the image.
+         *
+         * @param result image for the result
+         */
+        template <typename U, std::size_t N>
+        void materialize(Image<U, N>& result) const
+        {
+            materialize(result.data);
+        }
+
+        /**
+         * Evaluate the pipeline into the array.
+         *
+         * @param result array for the result
+         */
+        template <typename U, std::size_t N>
+        void materialize(std::array<U, N>& result) const
+        {
+            static_assert(N == Derived::size, "size of the result must be the same as size of the pipeline");
+            Derived stage = derived();
+            for (std::size_t i = 0; i < N; i++) {
+                result[i] = U(stage.next());
+            }
+        }
+
+        /**
+         * Fold all pixels of the pipeline.
+         *
+         * @param init initial value
+         * @param operation function (accumulator, pixel) -> accumulator
+         * @return the accumulator
+         */
+        template <typename R, typename Operation>
+        R reduce(R init, Operation operation) const
+        {
+            Derived stage = derived();
+            for (std::size_t i = 0; i < Derived::size; i++) {
+                init = operation(init, stage.next());
+            }
+            return init;
+        }
+
+        /**
+         * Find the position of the maximal value in the range (the first one if there are more).
+         *
+         * @param begin first pixel of the range
+         * @param end pixel after the range
+         * @return index of the maximal value (end if the range is empty)
+         */
+        std::size_t argmax(std::size_t begin = 0, std::size_t end = Derived::size) const
+        {
+            Derived stage = derived();
+            for (std::size_t i = 0; i < begin; i++) {
+                stage.next();
+            }
+            std::size_t index = end;
+            typename Derived::value_type maximum = 0;
+            for (std::size_t i = begin; i < end; i++) {
+                auto value = stage.next();
+                if (index == end || value > maximum) {
+                    maximum = value;
+                    index = i;
+                }
+            }
+            return index;
+        }
+
+    private:
+        const Derived& derived() const { return static_cast<const Derived&>(*this); }
+    };
+
+    /**
+     * Beginning of the pipeline - pixels of the image.
+     */
+    template <typename T, std::size_t N>
+    class Source : public Stage<Source<T, N>> {
+    public:
+        using value_type = T;
+        static constexpr std::size_t size = N;
+
+        Source(const T* data)
+            : m_data(data)
+        {
+        }
+
+        value_type next() { return *m_data++; }
+
+    private:
+        const T* m_data;
+    };
+
+    template <typename Source>
+    class Calibrate : public Stage<Calibrate<Source>> {
+    public:
+        using value_type = typename Source::value_type;
+        static constexpr std::size_t size = Source::size;
+        static_assert(std::is_integral<value_type>::value && sizeof(value_type) <= 2, "calibration is for pixels up to 16 bits");
+
+        Calibrate(Source source, const uint16_t* offset, const uint16_t* gain, int shift, bool isValid)
+            : m_source(source)
+            , m_offset(offset)
+            , m_gain(gain)
+            , m_shift(shift)
+            , m_isValid(isValid)
+        {
+        }
+
+        value_type next()
+        {
+            value_type raw = m_source.next();
+            if (!m_isValid) {
+                return raw;
+            }
+            int32_t value = int32_t(raw) - *m_offset++;
+            uint16_t gain = *m_gain++;
+            // 16-bit value * 16-bit gain fits in uint32_t
+            uint32_t corrected = value < 0 ? 0 : (uint32_t(value) * gain) >> m_shift;
+            return std::min<uint32_t>(corrected, std::numeric_limits<value_type>::max());
+        }
+
+    private:
+        Source m_source;
+        const uint16_t* m_offset;
+        const uint16_t* m_gain;
+        int m_shift;
+        bool m_isValid;
+    };
+
+    template <typename Source>
+    class Smooth : public Stage<Smooth<Source>> {
+    public:
+        using value_type = typename Source::value_type;
+        static constexpr std::size_t size = Source::size;
+
+        Smooth(Source source)
+            : m_source(source)
+        {
+        }
+
+        value_type next()
+        {
+            if (m_index == 0) {
+                m_actual = m_source.next();
+                m_previous = m_actual;
+            }
+            value_type following = ++m_index < size ? m_source.next() : m_actual;
+            value_type value = (m_previous + 2 * m_actual + following) / 4;
+            m_previous = m_actual;
+            m_actual = following;
+            return value;
+        }
+
+    private:
+        Source m_source;
+        std::size_t m_index = 0;
+        value_type m_previous = 0;
+        value_type m_actual = 0;
+    };
+
+    template <typename Source>
+    class Difference : public Stage<Difference<Source>> {
+    public:
+        using value_type = std::conditional_t<std::is_floating_point<typename Source::value_type>::value,
+            typename Source::value_type, int32_t>;
+        static constexpr std::size_t size = Source::size;
+
+        Difference(Source source)
+            : m_source(source)
+        {
+        }
+
+        value_type next()
+        {
+            value_type actual = m_source.next();
+            value_type value = m_isFirst ? 0 : actual - m_previous;
+            m_isFirst = false;
+            m_previous = actual;
+            return value;
+        }
+
+    private:
+        Source m_source;
+        value_type m_previous = 0;
+        bool m_isFirst = true;
+    };
+
+    template <typename Source>
+    class Abs : public Stage<Abs<Source>> {
+    public:
+        using value_type = typename Source::value_type;
+        static constexpr std::size_t size = Source::size;
+
+        Abs(Source source)
+            : m_source(source)
+        {
+        }
+
+        value_type next()
+        {
+            value_type value = m_source.next();
+            return value < 0 ? -value : value;
+        }
+
+    private:
+        Source m_source;
+    };
+
+    template <typename Source>
+    class Threshold : public Stage<Threshold<Source>> {
+    public:
+        using value_type = typename Source::value_type;
+        static constexpr std::size_t size = Source::size;
+
+        Threshold(Source source, value_type limit)
+            : m_source(source)
+            , m_limit(limit)
+        {
+        }
+
+        value_type next()
+        {
+            value_type value = m_source.next();
+            return value < m_limit ? 0 : value;
+        }
+
+    private:
+        Source m_source;
+        value_type m_limit;
+    };
+
+    /**
+     * Start the pipeline from the image (no copy - the image must exist during the evaluation).
+     *
+     * @param image input image
+     */
+    template <typename T, std::size_t N>
+    Source<T, N> from(const Image<T, N>& image)
+    {
+        return { image.data.data() };
+    }
+
+    /**
+     * Start the pipeline from the array (no copy - the array must exist during the evaluation).
+     *
+     * @param data input array
+     */
+    template <typename T, std::size_t N>
+    Source<T, N> from(const std::array<T, N>& data)
+    {
+        return { data.data() };
+    }
+
+} // namespace pipeline
+} // namespace nxpcup
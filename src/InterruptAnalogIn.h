@@ -0,0 +1,38 @@
+#pragma once
+
+#include "mbed.h"
+
+namespace nxpcup {
+
+/**
+ * Analog input which can be read in the interrupt (e.g. from a Ticker).
+ *
+ * HAL is used directly because AnalogIn could lock mutex - not allowed in the interrupt.
+ */
+class InterruptAnalogIn {
+public:
+    /**
+     * Constructor of class InterruptAnalogIn.
+     *
+     * @param pin analog pin
+     */
+    InterruptAnalogIn(PinName pin)
+    {
+        analogin_init(&m_analogIn, pin);
+    }
+
+    /**
+     * Read the input without locking.
+     *
+     * @return value in range (0 <-> 65535)
+     */
+    uint16_t read_u16()
+    {
+        return analogin_read_u16(&m_analogIn);
+    }
+
+private:
+    analogin_t m_analogIn;
+};
+
+} // namespace nxpcup
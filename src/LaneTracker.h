@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+
+#include "Image.h"
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Tracker of the lane borders with several hypotheses (particle filter).
+ *
+ * Every hypothesis is the position of left border and the width of the lane.
+ * Every frame: move the hypotheses by the motion of the car and random jitter,
+ * weight them by the edges in the image (e.g. difference image from camera),
+ * take the estimate from the strongest cluster of hypotheses and resample.
+ * Some hypotheses are spread randomly every frame - the tracker recovers when it locks
+ * onto the wrong peak (glare, crossing, second line).
+ *
+ * Integer arithmetic and fixed memory - @{Config::PARTICLES} hypotheses.
+ *
+ * @tparam T type of the pixel
+ * @tparam N number of pixels in the image
+ */
+template <typename T = uint16_t, std::size_t N = 128>
+class BasicLaneTracker {
+public:
+    using ImageType = T;
+
+    struct Config {
+        int16_t initialWidth = 90; /**< expected width of the lane in pixels **/
+        int16_t minimalWidth = 50; /**< minimal width of the lane in pixels **/
+        int16_t maximalWidth = 120; /**< maximal width of the lane in pixels **/
+        uint8_t positionJitter = 2; /**< maximal random move of the border per frame in pixels **/
+        uint8_t widthJitter = 1; /**< maximal random change of the width per frame in pixels **/
+        uint8_t respawnCount = 2; /**< number of hypotheses spread randomly every frame **/
+        uint8_t scoreShift = 6; /**< score of the edge is pixel value / 2^scoreShift (max 255) **/
+        uint8_t minimalScore = 8; /**< minimal score of both edges to support the hypothesis **/
+        float shiftPerMeterDegree = 0; /**< move of the lane in pixels per meter of driving and degree of steering (0 = only jitter) **/
+
+        static constexpr int dataSize = N;
+        static constexpr int CENTER = dataSize / 2;
+        static constexpr int PARTICLES = 32;
+        static constexpr int NEIGHBORHOOD = 3; /**< hypotheses closer than this (in pixels) to the strongest one form the estimate **/
+
+        static_assert(PARTICLES > 0);
+    };
+
+    /**
+     * Constructor of class BasicLaneTracker.
+     *
+     * @param config struct @{Config}
+     */
+    BasicLaneTracker(Config config)
+        : m_config(config)
+    {
+        reset();
+    }
+
+    /**
+     * Process new image.
+     *
+     * @param data image from camera
+     * @param shift move of the lane in pixels from the previous frame
+     */
+    void update(const std::array<ImageType, Config::dataSize>& data, int shift = 0)
+    {
+        predict(shift);
+        uint32_t totalWeight = weight(data);
+        estimate(totalWeight);
+        resample(totalWeight);
+    }
+
+    /**
+     * Process new image, the move of the lane is derived from the encoder and steering.
+     *
+     * @param data image from camera
+     * @param encoderDistance distance from one encoder in meters
+     * @param steeringAngle actual angle of the steering in degrees
+     */
+    void update(const std::array<ImageType, Config::dataSize>& data, float encoderDistance, int steeringAngle)
+    {
+        float distance = encoderDistance - m_lastDistance;
+        m_lastDistance = encoderDistance;
+        m_shiftRemainder += distance * steeringAngle * m_config.shiftPerMeterDegree;
+        int shift = int(m_shiftRemainder);
+        m_shiftRemainder -= shift;
+        update(data, shift);
+    }
+
+    /**
+     * Process new image.
+     *
+     * @param image image from camera (no copy)
+     * @param shift move of the lane in pixels from the previous frame
+     */
+    void update(const Image<ImageType, N>& image, int shift = 0)
+    {
+        update(image.data, shift);
+    }
+
+    /**
+     * Get the estimated position of left border (can be outside of the image).
+     */
+    int leftBorder() const { return m_left; }
+
+    /**
+     * Get the estimated position of right border (can be outside of the image).
+     */
+    int rightBorder() const { return m_left + m_width; }
+
+    /**
+     * Get the estimated width of the lane in pixels.
+     */
+    int width() const { return m_width; }
+
+    /**
+     * Get the confidence of the estimate - weight of the supported hypotheses
+     * in the cluster of the estimate (0 <-> 100).
+     */
+    uint8_t confidence() const { return m_confidence; }
+
+    /**
+     * Calculate the error from the estimated borders as distance from the center
+     * (same meaning as @{BasicBorderDetector::error()}).
+     *
+     * @param percentCoefficient how many percent of error return (0 <-> 100)
+     */
+    int error(const int percentCoefficient = 100) const
+    {
+        int rawError = (rightBorder() - Config::CENTER - (Config::CENTER - leftBorder())) / 2;
+        return (rawError * percentCoefficient) / 100;
+    }
+
+    /**
+     * Get the actual configuration of the @{BasicLaneTracker}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{BasicLaneTracker}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(const Config& config)
+    {
+        m_config = config;
+        reset();
+    }
+
+    /**
+     * Spread the hypotheses over the whole image.
+     */
+    void reset()
+    {
+        for (int i = 0; i < Config::PARTICLES; i++) {
+            m_particles[i] = randomParticle();
+        }
+        m_left = Config::CENTER - m_config.initialWidth / 2;
+        m_width = m_config.initialWidth;
+        m_confidence = 0;
+    }
+
+    /**
+     * Set all hypotheses to the known position of the lane (e.g. from @{BasicBorderDetector}).
+     *
+     * @param leftBorder position of left border
+     * @param rightBorder position of right border
+     */
+    void reset(int leftBorder, int rightBorder)
+    {
+        int width = nxpcup::clamp<int>(rightBorder - leftBorder, m_config.minimalWidth, m_config.maximalWidth);
+        for (auto& particle : m_particles) {
+            particle = { int16_t(leftBorder), int16_t(width) };
+        }
+        m_left = leftBorder;
+        m_width = width;
+        m_confidence = 100;
+    }
+
+private:
+    struct Particle {
+        int16_t left;
+        int16_t width;
+    };
+
+    /**
+     * Move the hypotheses and add the jitter, spread the last @{Config::respawnCount} randomly.
+     */
+    void predict(int shift)
+    {
+        int respawnFrom = Config::PARTICLES - std::min<int>(m_config.respawnCount, Config::PARTICLES);
+        for (int i = 0; i < Config::PARTICLES; i++) {
+            Particle& particle = m_particles[i];
+            if (i >= respawnFrom) {
+                particle = randomParticle();
+                continue;
+            }
+            int left = particle.left + shift + jitter(m_config.positionJitter);
+            int width = particle.width + jitter(m_config.widthJitter);
+            particle.width = nxpcup::clamp<int>(width, m_config.minimalWidth, m_config.maximalWidth);
+            particle.left = nxpcup::clamp<int>(left, -particle.width, Config::dataSize - 1);
+        }
+    }
+
+    /**
+     * Weight the hypotheses by the edges in the image.
+     *
+     * @return sum of the weights
+     */
+    uint32_t weight(const std::array<ImageType, Config::dataSize>& data)
+    {
+        uint32_t totalWeight = 0;
+        for (int i = 0; i < Config::PARTICLES; i++) {
+            const Particle& particle = m_particles[i];
+            uint32_t left = score(data, particle.left);
+            uint32_t right = score(data, particle.left + particle.width);
+            m_weights[i] = (1 + left) * (1 + right);
+            m_isSupported[i] = left >= m_config.minimalScore && right >= m_config.minimalScore;
+            totalWeight += m_weights[i];
+        }
+        return totalWeight;
+    }
+
+    /**
+     * Weighted mean of the cluster around the strongest hypothesis and the confidence.
+     *
+     * The mean of all hypotheses would fall between two peaks (e.g. the lane and a second line),
+     * only the hypotheses in @{Config::NEIGHBORHOOD} of the strongest one are averaged.
+     */
+    void estimate(uint32_t totalWeight)
+    {
+        int strongest = 0;
+        for (int i = 1; i < Config::PARTICLES; i++) {
+            if (m_weights[i] > m_weights[strongest]) {
+                strongest = i;
+            }
+        }
+        const Particle center = m_particles[strongest];
+
+        int64_t left = 0;
+        int64_t width = 0;
+        uint32_t clusterWeight = 0;
+        uint32_t supportedWeight = 0;
+        for (int i = 0; i < Config::PARTICLES; i++) {
+            const Particle& particle = m_particles[i];
+            if (nxpcup::abs(particle.left - center.left) > Config::NEIGHBORHOOD
+                || nxpcup::abs(particle.width - center.width) > Config::NEIGHBORHOOD) {
+                continue;
+            }
+            left += int64_t(m_weights[i]) * particle.left;
+            width += int64_t(m_weights[i]) * particle.width;
+            clusterWeight += m_weights[i];
+            if (m_isSupported[i]) {
+                supportedWeight += m_weights[i];
+            }
+        }
+        m_left = left / clusterWeight;
+        m_width = width / clusterWeight;
+        m_confidence = (uint64_t(supportedWeight) * 100) / totalWeight;
+    }
+
+    /**
+     * Systematic resampling - new hypotheses are copies of the old ones proportionally to the weights.
+     */
+    void resample(uint32_t totalWeight)
+    {
+        std::array<Particle, Config::PARTICLES> old = m_particles;
+        uint32_t step = totalWeight / Config::PARTICLES;
+        uint32_t pointer = random(std::max<uint32_t>(step, 1));
+        uint32_t cumulative = m_weights[0];
+        int source = 0;
+        for (int i = 0; i < Config::PARTICLES; i++) {
+            while (pointer >= cumulative && source < Config::PARTICLES - 1) {
+                cumulative += m_weights[++source];
+            }
+            m_particles[i] = old[source];
+            pointer += step;
+        }
+    }
+
+    /**
+     * Score of the edge around the position (0 <-> 255, 0 outside of the image).
+     */
+    uint32_t score(const std::array<ImageType, Config::dataSize>& data, int position) const
+    {
+        if (position < 0 || position >= Config::dataSize) {
+            return 0;
+        }
+        ImageType value = data[position];
+        if (position > 0) {
+            value = std::max(value, data[position - 1]);
+        }
+        if (position < Config::dataSize - 1) {
+            value = std::max(value, data[position + 1]);
+        }
+        if (value <= 0) {
+            return 0;
+        }
+        return std::min<uint32_t>(uint32_t(value) >> m_config.scoreShift, 255);
+    }
+
+    Particle randomParticle()
+    {
+        int width = m_config.minimalWidth + random(m_config.maximalWidth - m_config.minimalWidth + 1);
+        return { int16_t(int(random(Config::dataSize + width)) - width), int16_t(width) };
+    }
+
+    /**
+     * Random value in the range -range <-> range.
+     */
+    int jitter(int range)
+    {
+        return int(random(2 * range + 1)) - range;
+    }
+
+    /**
+     * Random value in the range 0 <-> limit - 1 (linear congruential generator).
+     */
+    uint32_t random(uint32_t limit)
+    {
+        m_random = m_random * 1664525 + 1013904223;
+        return (m_random >> 8) % limit;
+    }
+
+    Config m_config;
+
+    std::array<Particle, Config::PARTICLES> m_particles;
+    std::array<uint32_t, Config::PARTICLES> m_weights = {};
+    std::array<bool, Config::PARTICLES> m_isSupported = {};
+    uint32_t m_random = 1;
+
+    int m_left = 0;
+    int m_width = 0;
+    uint8_t m_confidence = 0;
+
+    float m_lastDistance = 0;
+    float m_shiftRemainder = 0;
+};
+
+/**
+ * Lane tracker for the image from @{Camera} (128 pixels, uint16_t).
+ */
+using LaneTracker = BasicLaneTracker<>;
+
+} // namespace nxpcup
@@ -1,25 +1,36 @@
 #pragma once
 
 // Header file with logging functions
+//
+// The functions write to any serial line with putc() (and printf() for the terminal) - Serial, RawSerial or
+// @{BasicCommandChannel} (the logging shares the link with the tuning).
 
 #include "BorderDetector.h"
+#include "SystemIdentification.h"
 #include "mbed.h"
 #include <optional>
 #include <type_traits>
 
-template <typename T>
-void send32bits(Serial& serial, T data)
+template <typename T, typename SerialType>
+void send32bits(SerialType& serial, T data)
 {
     static_assert(sizeof(T) == 4);
-    int32_t cdata = static_cast<int32_t>(data);
-    serial.putc(cdata >> 24);
-    serial.putc(cdata >> 16);
-    serial.putc(cdata >> 8);
-    serial.putc(cdata);
+    if constexpr (std::is_floating_point<T>::value) {
+        uint8_t* cdata = reinterpret_cast<uint8_t*>(&data);
+        for (int i : { 0, 1, 2, 3 }) {
+            serial.putc(cdata[i]);
+        }
+    } else {
+        int32_t cdata = static_cast<int32_t>(data);
+        serial.putc(cdata >> 24);
+        serial.putc(cdata >> 16);
+        serial.putc(cdata >> 8);
+        serial.putc(cdata);
+    }
 }
 
-template <typename T>
-void send16bits(Serial& serial, T data)
+template <typename T, typename SerialType>
+void send16bits(SerialType& serial, T data)
 {
     static_assert(sizeof(T) == 2);
     int16_t cdata = static_cast<int16_t>(data);
@@ -27,40 +38,30 @@ void send16bits(Serial& serial, T data)
     serial.putc(cdata);
 }
 
-template <>
-void send32bits<float>(Serial& serial, float data)
-{
-    uint8_t* cdata = reinterpret_cast<uint8_t*>(&data);
-    for (int i : { 0, 1, 2, 3 }) {
-        serial.putc(cdata[i]);
-    }
-}
-
-template <typename T>
-void send64bits(Serial& serial, T data)
+template <typename T, typename SerialType>
+void send64bits(SerialType& serial, T data)
 {
     static_assert(sizeof(T) == 8);
-    int64_t cdata = static_cast<int64_t>(data);
-    serial.putc(cdata >> 56);
-    serial.putc(cdata >> 48);
-    serial.putc(cdata >> 40);
-    serial.putc(cdata >> 32);
-    serial.putc(cdata >> 24);
-    serial.putc(cdata >> 16);
-    serial.putc(cdata >> 8);
-    serial.putc(cdata);
-}
-
-template <>
-void send64bits<double>(Serial& serial, double data)
-{
-    uint8_t* cdata = reinterpret_cast<uint8_t*>(&data);
-    for (int i : { 0, 1, 2, 3, 4, 5, 6, 7 }) {
-        serial.putc(cdata[i]);
+    if constexpr (std::is_floating_point<T>::value) {
+        uint8_t* cdata = reinterpret_cast<uint8_t*>(&data);
+        for (int i : { 0, 1, 2, 3, 4, 5, 6, 7 }) {
+            serial.putc(cdata[i]);
+        }
+    } else {
+        int64_t cdata = static_cast<int64_t>(data);
+        serial.putc(cdata >> 56);
+        serial.putc(cdata >> 48);
+        serial.putc(cdata >> 40);
+        serial.putc(cdata >> 32);
+        serial.putc(cdata >> 24);
+        serial.putc(cdata >> 16);
+        serial.putc(cdata >> 8);
+        serial.putc(cdata);
     }
 }
 
-void sendCameraDataLorris(Serial& serial, const std::array<uint16_t, 128>& data)
+template <typename SerialType>
+void sendCameraDataLorris(SerialType& serial, const std::array<uint16_t, 128>& data)
 {
     serial.putc(0x80); // Header
     serial.putc(0x01); // Command: 0x01 = camera
@@ -70,7 +71,8 @@ void sendCameraDataLorris(Serial& serial, const std::array<uint16_t, 128>& data)
     }
 }
 
-void sendDetectorDataLorris(Serial& serial, nxpcup::BorderDetector& detector)
+template <typename SerialType>
+void sendDetectorDataLorris(SerialType& serial, nxpcup::BorderDetector& detector)
 {
     serial.putc(0x80); // Header
     serial.putc(0x02); // Command: 0x02 = detector
@@ -80,8 +82,9 @@ void sendDetectorDataLorris(Serial& serial, nxpcup::BorderDetector& detector)
     serial.putc(detector.error());
 }
 
+template <typename SerialType>
 void sendTimeDataLorris(
-    Serial& serial, Timer& loopTime, const uint16_t loopTimePeriodOverflowCounter)
+    SerialType& serial, Timer& loopTime, const uint16_t loopTimePeriodOverflowCounter)
 {
     serial.putc(0x80); // Header
     serial.putc(0x03); // Command: 0x03 = time
@@ -90,8 +93,9 @@ void sendTimeDataLorris(
     send16bits(serial, loopTimePeriodOverflowCounter); // 2 bytes
 }
 
+template <typename SerialType>
 void sendEncoderDataLorris(
-    Serial& serial, uint16_t dataLeft, uint16_t dataRight)
+    SerialType& serial, uint16_t dataLeft, uint16_t dataRight)
 {
     serial.putc(0x80); // Header
     serial.putc(0x04); // Command: 0x04 = counter
@@ -102,7 +106,8 @@ void sendEncoderDataLorris(
     serial.putc(dataRight);
 }
 
-void sendPeaksDataLorris(Serial& serial, const int16_t peaks)
+template <typename SerialType>
+void sendPeaksDataLorris(SerialType& serial, const int16_t peaks)
 {
     serial.putc(0x80); // Header
     serial.putc(0x05); // Command: 0x05 = peaks from border detector
@@ -110,8 +115,9 @@ void sendPeaksDataLorris(Serial& serial, const int16_t peaks)
     send16bits(serial, peaks);
 }
 
+template <typename SerialType>
 void sendObstacleDataLorris(
-    Serial& serial,
+    SerialType& serial,
     const int obstacleDistance,
     const int obstacleAngle,
     const int distanceThatTriggered,
@@ -126,8 +132,9 @@ void sendObstacleDataLorris(
     serial.putc(static_cast<int8_t>(avoidingObstacle));
 }
 
+template <typename SerialType>
 void sendObstacleDetectorDataLorris(
-    Serial& serial,
+    SerialType& serial,
     const int leftSensorValue,
     const int rightSensorValue,
     const int avoidingObstacle)
@@ -140,8 +147,9 @@ void sendObstacleDetectorDataLorris(
     serial.putc(static_cast<int8_t>(avoidingObstacle));
 }
 
+template <typename SerialType>
 void sendSteeringDataLorris(
-    Serial& serial, nxpcup::BorderDetector& detector, const int roadError)
+    SerialType& serial, nxpcup::BorderDetector& detector, const int roadError)
 {
     serial.putc(0x80); // Header
     serial.putc(0x07); // Command: 0x07 - steering data
@@ -150,8 +158,9 @@ void sendSteeringDataLorris(
     send32bits(serial, roadError);
 }
 
+template <typename SerialType>
 void sendMotorDataLorris(
-    Serial& serial,
+    SerialType& serial,
     const float motorLD,
     const float motorLA,
     const float motorRD,
@@ -166,8 +175,9 @@ void sendMotorDataLorris(
     send32bits(serial, motorRA * 1000);
 }
 
+template <typename SerialType>
 void sendEncoderDistanceLorris(
-    Serial& serial, float distanceLeft, float distanceRight)
+    SerialType& serial, float distanceLeft, float distanceRight)
 {
     serial.putc(0x80); // Header
     serial.putc(0x09); // Command: 0x09 = encoder distance
@@ -176,8 +186,24 @@ void sendEncoderDistanceLorris(
     send32bits(serial, int(distanceRight * 1000));
 }
 
+template <typename SerialType>
+void sendIdentificationDataLorris(
+    SerialType& serial, const nxpcup::SystemIdentification& identification)
+{
+    const auto& samples = identification.samples();
+    for (int i = 0; i < identification.sampleCount(); i++) {
+        serial.putc(0x80); // Header
+        serial.putc(0x0A); // Command: 0x0A = identification sample
+        serial.putc(6); // Packet data length
+        send16bits(serial, int16_t(i));
+        send16bits(serial, samples[i].input);
+        send16bits(serial, samples[i].output);
+    }
+}
+
+template <typename SerialType>
 void sendCameraDataTerminal(
-    Serial& serial, const std::array<uint16_t, 128>& data)
+    SerialType& serial, const std::array<uint16_t, 128>& data)
 {
     serial.printf("L:");
     for (uint16_t d : data) {
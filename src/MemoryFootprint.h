@@ -0,0 +1,146 @@
+#pragma once
+
+// Header file with static RAM footprint of the library classes
+//
+// Not included by NXPCUP-library.h unless NXPCUP_MEMORY_FOOTPRINT or NXPCUP_RAM_BUDGET is defined.
+// Define NXPCUP_RAM_BUDGET (in bytes) before including this file to check
+// the representative configuration (both cameras with calibration, obstacle detector with servo,
+// identification, parameter store, command channel, telemetry) in compile time.
+// The memory_footprint target of the host tests compiles it and prints the size of every object file.
+
+#include <stddef.h>
+
+#include "mbed.h"
+
+#include "AvoidancePlanner.h"
+#include "Battery.h"
+#include "Buttons.h"
+#include "Camera.h"
+#include "CommandChannel.h"
+#include "DistanceCalibration.h"
+#include "Encoder.h"
+#include "Motor.h"
+#include "MotorControl.h"
+#include "ObstacleMap.h"
+#include "ParameterStore.h"
+#include "SensorFilter.h"
+#include "Servo.h"
+#include "StateEstimator.h"
+#include "SteeringControl.h"
+#include "SystemIdentification.h"
+
+#include "BorderDetector.h"
+#include "LaneTracker.h"
+#include "ObstacleDetector.h"
+#include "ObstacleDetectorWithServo.h"
+
+namespace nxpcup {
+namespace footprint {
+
+    struct Entry {
+        const char* name;
+        size_t size;
+    };
+
+    constexpr Entry CLASSES[] = {
+        { "Motor", sizeof(Motor) },
+        { "Motor::Config", sizeof(Motor::Config) },
+        { "Servo", sizeof(Servo) },
+        { "Servo::Config", sizeof(Servo::Config) },
+        { "Encoder", sizeof(Encoder) },
+        { "Encoder::Config", sizeof(Encoder::Config) },
+        { "MotorControl", sizeof(MotorControl) },
+        { "MotorControl::Config", sizeof(MotorControl::Config) },
+        { "StateEstimator", sizeof(StateEstimator) },
+        { "SteeringControl", sizeof(SteeringControl) },
+        { "SteeringControl::Config", sizeof(SteeringControl::Config) },
+        { "Camera", sizeof(Camera) },
+        { "Camera::Config", sizeof(Camera::Config) },
+        { "Camera::Calibration", sizeof(Camera::Calibration) },
+        { "BorderDetector", sizeof(BorderDetector) },
+        { "LaneTracker", sizeof(LaneTracker) },
+        { "Battery", sizeof(Battery) },
+        { "Buttons", sizeof(Buttons) },
+        { "Buttons::Config", sizeof(Buttons::Config) },
+        { "SensorFilter", sizeof(SensorFilter) },
+        { "DistanceCalibration", sizeof(DistanceCalibration) },
+        { "CommandChannel", sizeof(CommandChannel) },
+        { "ObstacleMap", sizeof(ObstacleMap) },
+        { "AvoidancePlanner", sizeof(AvoidancePlanner) },
+        { "ObstacleDetector", sizeof(ObstacleDetector) },
+        { "ObstacleDetector::Config", sizeof(ObstacleDetector::Config) },
+        { "ObstacleDetectorWithServo", sizeof(ObstacleDetectorWithServo) },
+        { "ObstacleDetectorWithServo::Config", sizeof(ObstacleDetectorWithServo::Config) },
+        { "MotorIdentification", sizeof(MotorIdentification) },
+        { "SteeringIdentification", sizeof(SteeringIdentification) },
+        { "CommandChannel", sizeof(CommandChannel) },
+        { "ParameterStore<CarParameters>", sizeof(ParameterStore<CarParameters>) },
+        { "CarParameters", sizeof(CarParameters) },
+        { "Serial", sizeof(Serial) },
+    };
+
+#if DEVICE_FLASH
+    using ParameterBackend = FlashIapBackend;
+#else
+    using ParameterBackend = FileBackend;
+#endif
+
+    // static RAM of the features
+    constexpr size_t DRIVE = 2 * sizeof(Motor) + 2 * sizeof(Encoder) + 2 * sizeof(MotorControl)
+        + sizeof(Servo) + sizeof(SteeringControl);
+    constexpr size_t ONE_CAMERA = sizeof(Camera) + sizeof(BorderDetector);
+    constexpr size_t TWO_CAMERAS = 2 * sizeof(Camera) + sizeof(BorderDetector);
+    constexpr size_t CAMERA_CALIBRATION = sizeof(Camera::Calibration); // per camera, kept statically
+
+    constexpr size_t OBSTACLE_DETECTOR = sizeof(ObstacleDetector);
+    constexpr size_t OBSTACLE_DETECTOR_WITH_SERVO = sizeof(ObstacleDetectorWithServo);
+    constexpr size_t BUTTONS = sizeof(Buttons);
+    constexpr size_t TELEMETRY = sizeof(Serial);
+    constexpr size_t IDENTIFICATION = sizeof(MotorIdentification) + sizeof(SteeringIdentification); // sample buffers
+    constexpr size_t PARAMETER_STORE = sizeof(ParameterStore<CarParameters>) + sizeof(ParameterBackend)
+        + sizeof(CarParameters); // the loaded copy of the parameters
+    constexpr size_t COMMAND_CHANNEL = sizeof(CommandChannel) + sizeof(RawSerial);
+
+    constexpr Entry FEATURES[] = {
+        { "drive (2 motors, 2 encoders, servo, regulators)", DRIVE },
+        { "one camera", ONE_CAMERA },
+        { "two cameras", TWO_CAMERAS },
+        { "camera calibration", CAMERA_CALIBRATION },
+        { "obstacle detector", OBSTACLE_DETECTOR },
+        { "obstacle detector with servo", OBSTACLE_DETECTOR_WITH_SERVO },
+        { "buttons", BUTTONS },
+        { "telemetry", TELEMETRY },
+        { "identification (motor and steering)", IDENTIFICATION },
+        { "parameter store", PARAMETER_STORE },
+        { "command channel", COMMAND_CHANNEL },
+    };
+
+    // the largest configuration used on the car
+    constexpr size_t REPRESENTATIVE = DRIVE + TWO_CAMERAS + 2 * CAMERA_CALIBRATION + OBSTACLE_DETECTOR_WITH_SERVO
+        + IDENTIFICATION + PARAMETER_STORE + COMMAND_CHANNEL + TELEMETRY;
+
+#if defined NXPCUP_RAM_BUDGET
+    static_assert(REPRESENTATIVE <= NXPCUP_RAM_BUDGET, "Static RAM of the library exceeds NXPCUP_RAM_BUDGET");
+#endif
+
+} // namespace footprint
+
+/**
+ * Send the table of static RAM footprint to the serial line (terminal format).
+ *
+ * @param serial output serial line
+ */
+inline void printMemoryFootprint(Serial& serial)
+{
+    serial.printf("class: bytes\r\n");
+    for (const auto& entry : footprint::CLASSES) {
+        serial.printf("%s: %u\r\n", entry.name, static_cast<unsigned>(entry.size));
+    }
+    serial.printf("feature: bytes\r\n");
+    for (const auto& entry : footprint::FEATURES) {
+        serial.printf("%s: %u\r\n", entry.name, static_cast<unsigned>(entry.size));
+    }
+    serial.printf("representative: %u\r\n", static_cast<unsigned>(footprint::REPRESENTATIVE));
+}
+
+} // namespace nxpcup
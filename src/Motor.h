@@ -2,6 +2,7 @@
 
 #include "mbed.h"
 
+#include "Battery.h"
 #include "SoftPWM.h"
 #include "util.h"
 
@@ -9,15 +10,23 @@ namespace nxpcup {
 
 class Motor {
 public:
+    enum class DecayMode {
+        coast, /**< off part of the period - both inputs low, the motor runs freely (fast decay) **/
+        brake /**< off part of the period - both inputs high, the motor is shorted (slow decay, linear at low speed) **/
+    };
+
     struct Config {
         PinName pwm0; /**< pin0 with PWM for motor driver **/
         PinName pwm1; /**< pin1 with PWM for motor driver **/
         bool inverse = false; /**< inverse the direction of the motor **/
+        uint16_t periodUs = PERIOD_US; /**< period of the PWM in microseconds **/
+        DecayMode decayMode = DecayMode::coast; /**< behaviour of the driver in the off part of the period **/
+        bool dithering = false; /**< spread the fraction of the microsecond over the periods (only software PWM) **/
 
         static constexpr int PERIOD_US = 500; // 2000 Hz
-        static constexpr int MAX_POWER = 1000; // MUST BE DIVISIBLE BY PERIOD_US
-        static constexpr int POWER_DIVIDER = MAX_POWER / PERIOD_US; // 1000 / 2 = 500
-        static_assert(POWER_DIVIDER * PERIOD_US == MAX_POWER);
+        static constexpr int MAX_POWER = 1000; // range of power() - independent of the PWM period
+        // power per microsecond of the default period - kept for the user code, power() does not round to microseconds
+        [[deprecated("use MAX_POWER and duty()")]] static constexpr int POWER_DIVIDER = MAX_POWER / PERIOD_US;
     };
 
     /**
@@ -27,21 +36,8 @@ public:
      * @param pin0 name of the pin for motor driver (require PWM)
      */
     Motor(const PinName pin0, const PinName pin1)
-        : m_maxPowerPercent(100)
+        : Motor(pin0, pin1, Config::PERIOD_US)
     {
-#if defined MOTOR_HARDWARE_PWM
-        m_in0 = new PwmOut(pin0);
-        m_in1 = new PwmOut(pin1);
-#elif defined MOTOR_SOFTWARE_PWM
-        m_in0 = new SoftPWM(pin0);
-        m_in1 = new SoftPWM(pin1);
-#endif
-
-        m_in0->period_us(Config::PERIOD_US);
-        m_in1->period_us(Config::PERIOD_US);
-
-        m_in0->pulsewidth_us(0);
-        m_in1->pulsewidth_us(0);
     }
 
     /**
@@ -50,9 +46,15 @@ public:
      * @param config structure @{Config}
      */
     Motor(const Config& config)
-        : Motor(config.pwm0, config.pwm1)
+        : Motor(config.pwm0, config.pwm1, config.periodUs)
     {
         m_inverse = config.inverse;
+        m_decayMode = config.decayMode;
+#if defined MOTOR_SOFTWARE_PWM
+        m_in0.dither(config.dithering);
+        m_in1.dither(config.dithering);
+#endif
+        duty(0);
     }
 
     /**
@@ -60,22 +62,44 @@ public:
      *
      * @param power of the motor (-1000 <-> 1000)
      * 		  under 0 => backward, over 0 => forward, 0 stop
+     * 		  with battery (@{setBattery()}) it is the part of the nominal voltage
+     * 		  in @{DecayMode::brake} the power 0 brakes hard (both inputs at 1, the motor is shorted),
+     * 		  in @{DecayMode::coast} the motor runs freely
      */
     void power(int power)
     {
-        power = nxpcup::clamp<int>(power, -Config::MAX_POWER, Config::MAX_POWER);
+        duty(float(power) / Config::MAX_POWER);
+    }
 
-        power = (m_inverse ? -1 : 1) * power;
+    /**
+     * Set motor power with the full resolution of the PWM timer.
+     *
+     * @param duty of the motor (-1.0 <-> 1.0)
+     * 		  under 0 => backward, over 0 => forward, 0 stop
+     * 		  with battery (@{setBattery()}) it is the part of the nominal voltage
+     */
+    void duty(float duty)
+    {
+        duty = nxpcup::clamp<float>(duty, -1, 1);
+        if (m_battery) {
+            duty = nxpcup::clamp<float>(duty * m_battery->scale(), -1, 1);
+        }
+        if (m_inverse) {
+            duty = -duty;
+        }
         if (m_maxPowerPercent != 100) {
-            power = (power * m_maxPowerPercent) / 100;
+            duty = (duty * m_maxPowerPercent) / 100;
         }
 
-        if (power > 0) {
-            m_in0->pulsewidth_us(power / Config::POWER_DIVIDER);
-            m_in1->pulsewidth_us(0);
+        // the duty is converted to timer ticks by the PWM driver (not rounded to microseconds)
+        float magnitude = duty < 0 ? -duty : duty;
+        float on = duty > 0 ? 1 : 0;
+        if (m_decayMode == DecayMode::brake) {
+            m_in0.write(duty < 0 ? 1 - magnitude : 1);
+            m_in1.write(duty > 0 ? 1 - magnitude : 1);
         } else {
-            m_in0->pulsewidth_us(0);
-            m_in1->pulsewidth_us(-power / Config::POWER_DIVIDER);
+            m_in0.write(on * magnitude);
+            m_in1.write((1 - on) * magnitude);
         }
     }
 
@@ -90,6 +114,13 @@ public:
         m_maxPowerPercent = nxpcup::clamp<int>(percent, 0, 100);
     }
 
+    /**
+     * Set the battery for compensation of the power by the actual voltage.
+     *
+     * @param battery measured battery (nullptr = without compensation)
+     */
+    void setBattery(const Battery* battery) { m_battery = battery; }
+
     /**
      * Return the actual maximal motor power in percent (0 <-> 100).
      */
@@ -101,16 +132,37 @@ public:
     int maxPower() const { return Config::MAX_POWER; }
 
 private:
+    /**
+     * Constructor of class Motor - the period is set only once.
+     *
+     * @param pin0 name of the pin for motor driver (require PWM)
+     * @param pin1 name of the pin for motor driver (require PWM)
+     * @param periodUs period of the PWM in microseconds
+     */
+    Motor(const PinName pin0, const PinName pin1, uint16_t periodUs)
+        : m_in0(pin0)
+        , m_in1(pin1)
+        , m_maxPowerPercent(100)
+    {
+        m_in0.period_us(periodUs);
+        m_in1.period_us(periodUs);
+
+        m_in0.pulsewidth_us(0);
+        m_in1.pulsewidth_us(0);
+    }
+
 #if defined MOTOR_HARDWARE_PWM
-    PwmOut* m_in0;
-    PwmOut* m_in1;
+    PwmOut m_in0;
+    PwmOut m_in1;
 #elif defined MOTOR_SOFTWARE_PWM
-    SoftPWM* m_in0;
-    SoftPWM* m_in1;
+    SoftPWM m_in0;
+    SoftPWM m_in1;
 #endif
 
     bool m_inverse = false;
+    DecayMode m_decayMode = DecayMode::coast;
     int m_maxPowerPercent;
+    const Battery* m_battery = nullptr;
 };
 
 } // namespace nxpcup
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
+
 #include "mbed.h"
 
 #include "atoms/control/pid.h"
 
+#include "Clock.h"
 #include "Encoder.h"
 #include "Motor.h"
 
@@ -18,6 +21,7 @@ public:
         float antiWindup = 0.5; /**< constrain the influence of integration component - <0-1> of output range **/
         float nullSpeedThreshold = 0.05; /**< under this speed is the output power zero - [m/s] **/
         float nullSpeedPower = 0.2; /**< constant for slower start of robot **/
+        uint32_t periodUs = 10000; /**< nominal period of @{regulate()} - coefficientI is per this period **/
     };
 
     /**
@@ -31,8 +35,8 @@ public:
         : m_motor(motor)
         , m_encoder(encoder)
         , m_config(config)
+        , m_lastRegulationUs(systemClock().nowUs())
     {
-        m_motorMaxPower = m_motor.maxPower();
     }
 
     /**
@@ -66,14 +70,16 @@ public:
      * Calculate and set new power for motor.
      *
      * Take actual speed from encoder and required speed -> calculate error -> update power.
-     * @param timeSinceLastCallUs time in microseconds from last call this function (NOT USED)
+     * The integration is scaled by the real time from the last call (measured by @{systemClock()}).
      */
-    void regulate(uint16_t timeSinceLastCallUs)
+    void regulate()
     {
         m_actualSpeed = m_encoder.speed();
 
+        // longer gaps (e.g. first call, long frame) are limited to avoid windup jump
+        uint64_t elapsedUs = std::min<uint64_t>(systemClock().elapsedUs(m_lastRegulationUs), MAX_PERIODS * m_config.periodUs);
         float error = m_desiredSpeed - m_actualSpeed;
-        m_errorSum += m_config.coefficientI * error;
+        m_errorSum += m_config.coefficientI * error * (float(elapsedUs) / m_config.periodUs);
         if (m_errorSum > m_config.antiWindup) {
             m_errorSum = m_config.antiWindup;
         }
@@ -92,8 +98,17 @@ public:
             output = m_config.nullSpeedPower;
             m_errorSum = 0;
         }
-        output = output * m_motorMaxPower; // output <-1000; 1000>
-        m_motor.power(int32_t(output));
+        m_motor.duty(output); // full resolution of the PWM
+    }
+
+    /**
+     * Calculate and set new power for motor.
+     *
+     * @param timeSinceLastCallUs time in microseconds from last call this function (NOT USED)
+     */
+    [[deprecated("use regulate() - the time is measured by systemClock()")]] void regulate(uint16_t timeSinceLastCallUs)
+    {
+        regulate();
     }
 
     /**
@@ -122,17 +137,20 @@ public:
     {
         m_motor.power(0);
         m_errorSum = 0;
+        m_lastRegulationUs = systemClock().nowUs();
     }
 
 private:
+    static constexpr int MAX_PERIODS = 4;
+
     Motor& m_motor;
     Encoder& m_encoder;
     Config m_config;
 
     float m_desiredSpeed = 0; //[m/s]
     float m_actualSpeed = 0; //[m/s]
-    uint16_t m_motorMaxPower = 0;
     float m_errorSum = 0;
+    uint64_t m_lastRegulationUs;
 };
 
 } // namespace nxpcup
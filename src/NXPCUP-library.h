@@ -1,16 +1,34 @@
 #pragma once
 
+#include "Atomic.h"
+#include "AvoidancePlanner.h"
+#include "Battery.h"
 #include "Buttons.h"
 #include "Camera.h"
+#include "Clock.h"
+#include "CommandChannel.h"
+#include "DistanceCalibration.h"
 #include "Encoder.h"
+#include "ImagePipeline.h"
 #include "Motor.h"
 #include "MotorControl.h"
+#include "SensorFilter.h"
 #include "Servo.h"
+#include "StateEstimator.h"
+#include "SteeringControl.h"
 
 #include "BorderDetector.h"
+#include "LaneTracker.h"
 #include "ObstacleDetector.h"
 #include "ObstacleDetectorWithServo.h"
+#include "ObstacleMap.h"
+#include "ParameterStore.h"
+#include "SystemIdentification.h"
 
 #include "Config.h"
 
 #include "Log.h"
+
+#if defined NXPCUP_MEMORY_FOOTPRINT || defined NXPCUP_RAM_BUDGET
+#include "MemoryFootprint.h"
+#endif
@@ -2,6 +2,12 @@
 
 #include "mbed.h"
 
+#include "AvoidancePlanner.h"
+#include "Clock.h"
+#include "DistanceCalibration.h"
+#include "ObstacleMap.h"
+#include "SensorFilter.h"
+
 namespace nxpcup {
 
 class ObstacleDetector {
@@ -13,6 +19,17 @@ public:
         int moveFromObstacle; /**< how far from detected obstacle go - lower value -> closer to line detected  **/
         float encoderAvoidDistance; /**< when the detector find obstacle, the distance which must robot go then return to center of road and again search for obstacle  **/
         bool isDeactivate = false; /**< deactivate the detector -> still check the obstacle, but not correct the robot path  **/
+        SensorFilter::Config filter = {}; /**< filtration of the sensor values (thresholdDistance is used as threshold) **/
+        ObstacleMap::Config map = {}; /**< map for tracking of the obstacles during avoiding **/
+        int leftSensorAngle = 80; /**< direction of left sensor in degree (90 = straight, under 90 = left) **/
+        int rightSensorAngle = 100; /**< direction of right sensor in degree (90 = straight, under 90 = left) **/
+        DistanceCalibration::Config calibration = {}; /**< conversion of the sensor values to millimetres **/
+        uint16_t triggerDistanceMm = 0; /**< distance which trigger the detector in millimetres (0 = use thresholdDistance and ObstacleMap::Config::detectionRange, the calibration is not used) **/
+        float triggerTime = 0; /**< time to the obstacle which trigger the detector in seconds (extend triggerDistanceMm with the speed measured from encoder) **/
+        AvoidancePlanner::Config planner = {}; /**< smooth transition to the path next to the obstacle and back **/
+        float laneWidth = 0.5; /**< width of the lane in meters - converts the avoidance offset from the map to pixels (0 = only moveFromObstacle) **/
+
+        static constexpr int SPEED_AVERAGE = 4; // weight of new speed sample is 1 / SPEED_AVERAGE
     };
 
     enum class AvoidingObstacle {
@@ -30,7 +47,13 @@ public:
         : m_leftSensor(config.leftSensorPin)
         , m_rightSensor(config.rightSensorPin)
         , m_config(config)
+        , m_leftFilter(config.filter, config.thresholdDistance)
+        , m_rightFilter(config.filter, config.thresholdDistance)
+        , m_map(config.map)
+        , m_calibration(config.calibration)
+        , m_planner(config.planner)
     {
+        updateThreshold();
     }
 
     /**
@@ -40,12 +63,17 @@ public:
      * @param borderDetectorError error from border detector
      * @param leftBorder positon of left border from border detector
      * @param rightBorder positon of right border from border detector
+     * @param steeringAngle actual steering angle in degree around center (positive = right)
      */
     int error(float encoderDistance,
         int borderDetectorError,
         int leftBorder,
-        int rightBorder)
+        int rightBorder,
+        int steeringAngle = 0)
     {
+        m_map.move(encoderDistance, steeringAngle);
+        updateSpeed(encoderDistance);
+        updateThreshold();
         updateSensorValue();
         checkObstacle(encoderDistance);
 
@@ -53,18 +81,14 @@ public:
             return borderDetectorError;
         }
 
-        if (m_avoidingObstacle == AvoidingObstacle::no) {
+        if (!m_planner.isActive()) {
             return borderDetectorError;
         }
-        if (m_avoidingObstacle == AvoidingObstacle::onLeftSide) {
-            return leftBorder - (64 - m_config.moveFromObstacle); // see just right line;
-        }
-        // obstacle on the right side
-        return rightBorder - (64 + m_config.moveFromObstacle);
+        return avoidingError(borderDetectorError, leftBorder, rightBorder, encoderDistance);
     }
 
     /**
-     * Get the last measured value from left sensor.
+     * Get the last filtered value from left sensor.
      *
      * @return measured distance without unit
      */
@@ -74,7 +98,7 @@ public:
     }
 
     /**
-     * Get the last measured value from right sensor.
+     * Get the last filtered value from right sensor.
      *
      * @return measured distance without unit
      */
@@ -83,6 +107,42 @@ public:
         return m_rightSensorValue;
     }
 
+    /**
+     * Get the last distance measured by left sensor in millimetres.
+     */
+    int leftDistanceMm() const
+    {
+        return m_calibration.toMillimeters(m_leftSensorValue);
+    }
+
+    /**
+     * Get the last distance measured by right sensor in millimetres.
+     */
+    int rightDistanceMm() const
+    {
+        return m_calibration.toMillimeters(m_rightSensorValue);
+    }
+
+    /**
+     * Get the confidence that the left sensor see the obstacle.
+     *
+     * @return 0 <-> 100 (100 = triggered)
+     */
+    int leftConfidence() const
+    {
+        return m_leftFilter.confidence();
+    }
+
+    /**
+     * Get the confidence that the right sensor see the obstacle.
+     *
+     * @return 0 <-> 100 (100 = triggered)
+     */
+    int rightConfidence() const
+    {
+        return m_rightFilter.confidence();
+    }
+
     /**
      * Get actual state of obstacle avoiding.
      *
@@ -111,6 +171,14 @@ public:
         }
     }
 
+    /**
+     * Get the map of tracked obstacles.
+     */
+    const ObstacleMap& map() const
+    {
+        return m_map;
+    }
+
     /**
      * Get the actual configuration of the @{ObstacleDetector}.
      */
@@ -127,6 +195,12 @@ public:
     void setConfig(Config& config)
     {
         m_config = config;
+        m_leftFilter.setConfig(config.filter);
+        m_rightFilter.setConfig(config.filter);
+        m_map.setConfig(config.map);
+        m_calibration.setConfig(config.calibration);
+        m_planner.setConfig(config.planner);
+        updateThreshold();
         reset();
     }
 
@@ -137,6 +211,10 @@ public:
     {
         m_encoderDistanceStart = 0;
         m_avoidingObstacle = AvoidingObstacle::no;
+        m_hasAvoidanceOffset = false;
+        m_isMoving = false;
+        m_map.reset();
+        m_planner.reset();
     }
 
 private:
@@ -145,31 +223,116 @@ private:
      */
     void updateSensorValue()
     {
-        m_leftSensorValue = m_leftSensor.read_u16();
-        m_rightSensorValue = m_rightSensor.read_u16();
+        m_leftSensorValue = m_leftFilter.update(m_leftSensor.read_u16());
+        m_rightSensorValue = m_rightFilter.update(m_rightSensor.read_u16());
+
+        m_map.addMeasurement(m_config.leftSensorAngle, mapRange(m_leftSensorValue), m_leftFilter.isTriggered());
+        m_map.addMeasurement(m_config.rightSensorAngle, mapRange(m_rightSensorValue), m_rightFilter.isTriggered());
+    }
+
+    /**
+     * Get the range of the measurement for the map in meters - without the trigger distance
+     * the calibration is not trusted and @{ObstacleMap::Config::detectionRange} is used.
+     *
+     * @param raw value from sensor
+     */
+    float mapRange(int raw) const
+    {
+        if (m_config.triggerDistanceMm == 0) {
+            return m_map.config().detectionRange;
+        }
+        return m_calibration.toMillimeters(raw) / 1000.0f;
+    }
+
+    /**
+     * Set the threshold of the sensor filters from the trigger distance and actual speed.
+     */
+    void updateThreshold()
+    {
+        int threshold = m_config.thresholdDistance;
+        if (m_config.triggerDistanceMm != 0) {
+            float speedDistanceMm = m_speed * m_config.triggerTime * 1000;
+            threshold = m_calibration.toRaw(std::max<float>(m_config.triggerDistanceMm, speedDistanceMm));
+        }
+        m_leftFilter.setThreshold(threshold);
+        m_rightFilter.setThreshold(threshold);
+    }
+
+    /**
+     * Calculate the error for the path next to the obstacle.
+     *
+     * The target of the path is the lateral offset next to the obstacles from the map in meters,
+     * without mapped obstacle the border is kept @{Config::moveFromObstacle} from the center.
+     * The planner moves the path smoothly to the target and back, the offset is converted
+     * to pixels by the width of the lane (without @{Config::laneWidth} the path is in pixels).
+     */
+    int avoidingError(int borderDetectorError, int leftBorder, int rightBorder, float encoderDistance)
+    {
+        int side = m_avoidingSide == AvoidingObstacle::onLeftSide ? -1 : 1;
+        if (m_config.laneWidth > 0 && m_map.obstacleSide() != 0) {
+            m_avoidanceOffset = m_map.avoidanceOffset(side); // kept after the obstacle is passed
+            m_hasAvoidanceOffset = true;
+        }
+        float pixelsPerMeter = 1;
+        if (m_config.laneWidth > 0) {
+            pixelsPerMeter = std::max(rightBorder - leftBorder, 1) / m_config.laneWidth;
+        }
+        float target = m_avoidanceOffset;
+        if (!m_hasAvoidanceOffset) {
+            int borderError = side < 0
+                ? leftBorder - (64 - m_config.moveFromObstacle) // see just right line
+                : rightBorder - (64 + m_config.moveFromObstacle); // see just left line
+            target = (borderError - borderDetectorError) / pixelsPerMeter;
+        }
+        return borderDetectorError + int(m_planner.offset(target, encoderDistance) * pixelsPerMeter);
+    }
+
+    /**
+     * Measure the speed from the encoder distance between the calls of @{error()} (time from @{systemClock()}).
+     */
+    void updateSpeed(float encoderDistance)
+    {
+        uint64_t elapsedUs = systemClock().elapsedUs(m_lastSpeedUs);
+        if (m_isMoving && elapsedUs > 0) {
+            float speed = (encoderDistance - m_lastDistance) * 1000000 / elapsedUs;
+            m_speed += (speed - m_speed) / Config::SPEED_AVERAGE; // moving average - the encoder distance is quantized
+        }
+        m_lastDistance = encoderDistance;
+        m_isMoving = true;
     }
 
     /**
      * Check the actual data from sensors and modify the state of detector @{AvoidingObstacle}
      *
+     * The side of the obstacle is taken from the map, the avoiding ends when the map
+     * is clear or after @{Config::encoderAvoidDistance}.
+     *
      * @param encoderDistance distance from one encoder
      */
     void checkObstacle(float encoderDistance)
     {
         if (m_avoidingObstacle == AvoidingObstacle::no) {
-            if (m_leftSensorValue < m_config.thresholdDistance
-                && m_rightSensorValue < m_config.thresholdDistance) {
+            if (!m_leftFilter.isTriggered() && !m_rightFilter.isTriggered()) {
                 return;
             }
-            if (m_leftSensorValue > m_config.thresholdDistance) {
+            int side = m_map.obstacleSide();
+            if (side == 0) {
+                side = m_leftFilter.confidence() >= m_rightFilter.confidence() ? -1 : 1;
+            }
+            if (side < 0) {
                 m_avoidingObstacle = AvoidingObstacle::onLeftSide; // see just right line;
             } else {
                 m_avoidingObstacle = AvoidingObstacle::onRightSide; // see just left line
             }
+            m_avoidingSide = m_avoidingObstacle;
+            m_hasAvoidanceOffset = false;
             m_encoderDistanceStart = encoderDistance;
+            m_planner.start(encoderDistance, m_speed);
         } else {
-            if (m_encoderDistanceStart + m_config.encoderAvoidDistance < encoderDistance) {
+            if (m_map.isClear()
+                || m_encoderDistanceStart + m_config.encoderAvoidDistance < encoderDistance) {
                 m_avoidingObstacle = AvoidingObstacle::no;
+                m_planner.finish(encoderDistance, m_speed);
             }
         }
     }
@@ -177,11 +340,23 @@ private:
     AnalogIn m_leftSensor;
     AnalogIn m_rightSensor;
     Config m_config;
+    SensorFilter m_leftFilter;
+    SensorFilter m_rightFilter;
+    ObstacleMap m_map;
+    DistanceCalibration m_calibration;
+    AvoidancePlanner m_planner;
 
     AvoidingObstacle m_avoidingObstacle = AvoidingObstacle::no;
+    AvoidingObstacle m_avoidingSide = AvoidingObstacle::no; // side of the last obstacle - kept during return
+    float m_avoidanceOffset = 0; // meters from the road center (positive = right)
+    bool m_hasAvoidanceOffset = false;
     int m_leftSensorValue = 0;
     int m_rightSensorValue = 0;
     float m_encoderDistanceStart = 0;
+    float m_speed = 0; // measured from encoder in [m/s]
+    float m_lastDistance = 0;
+    uint64_t m_lastSpeedUs = 0;
+    bool m_isMoving = false;
 };
 
 } // namespace nxpcup
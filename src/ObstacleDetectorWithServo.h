@@ -1,15 +1,28 @@
 #pragma once
 
+#include <climits>
 #include <optional>
 
+#include "Atomic.h"
+#include "AvoidancePlanner.h"
+#include "Clock.h"
+#include "DistanceCalibration.h"
 #include "Image.h"
+#include "InterruptAnalogIn.h"
+#include "ObstacleMap.h"
 #include "Servo.h"
 #include "mbed.h"
+#include "util.h"
 
 namespace nxpcup {
 
 class ObstacleDetectorWithServo {
 public:
+    enum class ScanMode {
+        sweep, /**< move the servo back and forth over the whole range **/
+        adaptive /**< prefer positions in the lane ahead, stale positions and positions with rising value (after the first sweep) **/
+    };
+
     struct Config {
         PinName sensorPin; /**< analog in pin for optical obstacle sensor **/
         Servo::Config servoConfig; /**< configuration for servo which move with sensor **/
@@ -17,11 +30,33 @@ public:
         int moveFromObstacle; /**< how far from detected obstacle go - lower value -> closer to line detected **/
         float encoderAvoidDistance; /**< when the detector find obstacle, the distance which must robot go then return to center of road and again search for obstacle  **/
         bool isDeactivate = false; /**< deactivate the detector -> still check the obstacle, but not correct the robot path  **/
+        uint16_t sampleIntervalUs = 500; /**< period of the sampling ticker in microseconds **/
+        uint8_t oversampling = 10; /**< number of averaged samples for one position of servo **/
+        uint16_t settleTimeUs = 2000; /**< time for servo to start moving after the new command **/
+        uint16_t settleTimePerDegreeUs = 1700; /**< time for servo to move by one degree (SG90: 0.1 s / 60 degree) **/
+        ScanMode scanMode = ScanMode::sweep; /**< strategy for choosing the next servo position **/
+        uint8_t cameraFieldOfView = 100; /**< view angle of the camera in degree - maps the lane borders to the servo angle **/
+        ObstacleMap::Config map = {}; /**< map for tracking of the obstacles during avoiding **/
+        DistanceCalibration::Config calibration = {}; /**< conversion of the sensor values to millimetres **/
+        uint16_t triggerDistanceMm = 0; /**< distance which trigger the detector in millimetres (0 = use thresholdDistance and ObstacleMap::Config::detectionRange, the calibration is not used) **/
+        float triggerTime = 0; /**< time to the obstacle which trigger the detector in seconds (extend triggerDistanceMm with the speed measured from encoder) **/
+        AvoidancePlanner::Config planner = {}; /**< smooth transition to the path next to the obstacle and back **/
+        float laneWidth = 0.5; /**< width of the lane in meters - converts the avoidance offset from the map to pixels (0 = only moveFromObstacle) **/
 
         // 5 degree step is 36 image size...
         // 10 degree step is 18 image size...
         static constexpr int IMAGE_SIZE = 30;
         static constexpr int SERVO_MAX_RANGE_DEGREE = 180;
+
+        static constexpr int LANE_WEIGHT = 4; // priority multiplier of positions in the lane ahead
+        static constexpr int RISE_THRESHOLD = 2000; // rise of value which causes dwelling on the position
+        static constexpr int DWELL_SAMPLES = 2; // extra samples of the position with rising value
+        static constexpr int STALE_AGE = 2 * IMAGE_SIZE; // positions not visited for more samples are ignored
+
+        static constexpr int CAMERA_PIXELS = 128; // width of the camera image (lane borders) in pixels
+        static constexpr int CAMERA_CENTER = CAMERA_PIXELS / 2;
+
+        static constexpr int SPEED_AVERAGE = 4; // weight of new speed sample is 1 / SPEED_AVERAGE
     };
 
     enum class AvoidingObstacle {
@@ -36,12 +71,21 @@ public:
     /**
      * Constructor of class ObstacleDetectorWithServo.
      *
+     * Start the background sampling of the sensor.
+     *
      * @param config struct @{Config}
      */
     ObstacleDetectorWithServo(Config config)
         : m_sensor(config.sensorPin)
         , m_servo(config.servoConfig)
-        , m_config(config){};
+        , m_config(config)
+        , m_map(config.map)
+        , m_calibration(config.calibration)
+        , m_planner(config.planner)
+    {
+        moveServo(0);
+        m_sampleTicker.attach_us(callback(this, &ObstacleDetectorWithServo::sample), m_config.sampleIntervalUs);
+    }
 
     /**
      * Get the angle of servo for given index.
@@ -49,10 +93,10 @@ public:
      * @param index of the position (the range is define by @{Config::IMAGE_SIZE})
      * @return angle for the index
      */
-    int servoAngle(int index)
+    int servoAngle(int index) const
     {
         int servoAngleRange = m_servo.getMaxAngle() - m_servo.getMinAngle();
-        auto angle = m_servo.getMinAngle() + servoAngleRange * index / m_image.size;
+        auto angle = m_servo.getMinAngle() + servoAngleRange * index / Config::IMAGE_SIZE;
         return angle;
     }
 
@@ -65,13 +109,40 @@ public:
     }
 
     /**
-     * Get current value from sensor (withnout unit).
+     * Get last averaged value from sensor (withnout unit).
      */
     int sensorValue() const
     {
         return m_sensorValue;
     }
 
+    /**
+     * Get last averaged distance from sensor in millimetres.
+     */
+    int sensorDistanceMm() const
+    {
+        return m_calibration.toMillimeters(m_sensorValue);
+    }
+
+    /**
+     * Get the maximal age of positions in the lane ahead.
+     *
+     * @return number of samples since the least recently visited position in the lane
+     * 		   was sampled - worst-case detection latency in samples
+     */
+    int worstLaneAge() const
+    {
+        Scan scan;
+        m_published.read(scan);
+        int worst = 0;
+        for (int i = 0; i < Config::IMAGE_SIZE; i++) {
+            if (isInLane(i) && scan.age[i] > worst) {
+                worst = scan.age[i];
+            }
+        }
+        return worst;
+    }
+
     /**
      * Check the error on sensors and modify the trajectory if find obstacle.
      *
@@ -79,28 +150,29 @@ public:
      * @param borderDetectorError error from border detector
      * @param leftBorder positon of left border from border detector
      * @param rightBorder positon of right border from border detector
+     * @param steeringAngle actual steering angle in degree around center (positive = right)
      */
     int error(float encoderDistance,
         int borderDetectorError,
         int leftBorder,
-        int rightBorder)
+        int rightBorder,
+        int steeringAngle = 0)
     {
-        update();
+        m_published.read(m_scan);
+        setLane(leftBorder, rightBorder);
+        m_map.move(encoderDistance, steeringAngle);
+        updateSpeed(encoderDistance);
+        updateMap();
         check(encoderDistance);
 
         if (m_config.isDeactivate) {
             return borderDetectorError;
         }
 
-        if (m_avoidingObstacle == AvoidingObstacle::no) {
+        if (!m_planner.isActive()) {
             return borderDetectorError;
         }
-        if (m_avoidingObstacle == AvoidingObstacle::onLeftSide) {
-            return leftBorder - (64 - m_config.moveFromObstacle); // see just right line;
-        }
-        // obstacle on the right side
-        return rightBorder - (64 + m_config.moveFromObstacle);
-        ; // see just left line
+        return avoidingError(borderDetectorError, leftBorder, rightBorder, encoderDistance);
     }
 
     /**
@@ -141,6 +213,22 @@ public:
         return m_distanceThatTriggered;
     }
 
+    /**
+     * Get the distance that trigger the detector in millimetres.
+     */
+    int distanceThatTriggeredMm() const
+    {
+        return m_calibration.toMillimeters(m_distanceThatTriggered);
+    }
+
+    /**
+     * Get the map of tracked obstacles.
+     */
+    const ObstacleMap& map() const
+    {
+        return m_map;
+    }
+
     /**
      * Get the actual configuration of the @{ObstacleDetectorWithServo}.
      */
@@ -156,8 +244,13 @@ public:
      */
     void setConfig(Config& config)
     {
+        m_sampleTicker.detach();
         m_config = config;
+        m_map.setConfig(config.map);
+        m_calibration.setConfig(config.calibration);
+        m_planner.setConfig(config.planner);
         reset();
+        m_sampleTicker.attach_us(callback(this, &ObstacleDetectorWithServo::sample), m_config.sampleIntervalUs);
     }
 
     /**
@@ -167,46 +260,259 @@ public:
     {
         m_encoderDistanceStart = 0;
         m_avoidingObstacle = AvoidingObstacle::no;
+        m_hasAvoidanceOffset = false;
+        m_isMoving = false;
+        m_map.reset();
+        m_planner.reset();
     }
 
 private:
-    int update()
+    /**
+     * Positions sampled in the interrupt - published to the main loop as one consistent snapshot.
+     */
+    struct Scan {
+        ObstacleImage image;
+        std::array<uint8_t, Config::IMAGE_SIZE> age;
+        uint32_t sampleNumber;
+    };
+
+    /**
+     * Take one sample of the sensor - called by ticker.
+     *
+     * Wait until the servo settles, average @{Config::oversampling} samples,
+     * save them to the image and move the servo to the next position.
+     */
+    void sample()
     {
-        // filtration - average
-        m_sensorValue = 0;
-        for (int i = 0; i < 10; ++i) {
-            m_sensorValue += m_sensor.read_u16();
+        if (m_settleTicks > 0) {
+            m_settleTicks--;
+            return;
         }
-        m_sensorValue /= 10;
 
-        m_image[m_index] = m_sensorValue;
+        m_sampleSum += m_sensor.read_u16();
+        if (++m_sampleCount < m_config.oversampling) {
+            return;
+        }
+
+        m_sensorValue = m_sampleSum / m_sampleCount;
+        // the first sweep seeds the image - the first visit of the position is not a rise
+        bool isSeeded = m_sampled.sampleNumber >= Config::IMAGE_SIZE;
+        if (isSeeded && m_sensorValue > m_sampled.image[m_index] + Config::RISE_THRESHOLD) {
+            m_dwell = Config::DWELL_SAMPLES;
+        }
+        m_sampled.image[m_index] = m_sensorValue;
+        m_sampled.sampleNumber++;
+        m_sampleSum = 0;
+        m_sampleCount = 0;
+
+        for (auto& age : m_sampled.age) {
+            if (age < UINT8_MAX) {
+                age++;
+            }
+        }
+        m_sampled.age[m_index] = 0;
+        m_published.write(m_sampled);
+
+        if (m_config.scanMode == ScanMode::adaptive && isSeeded) {
+            moveServo(nextAdaptiveIndex());
+            return;
+        }
 
+        int index = m_index;
         if (m_direction == 1) {
-            m_index++;
-            if (m_index == (m_image.size - 1)) {
+            index++;
+            if (index == (Config::IMAGE_SIZE - 1)) {
                 m_direction = -1;
             }
         } else if (m_direction == -1) {
-            m_index--;
-            if (m_index == 0) {
+            index--;
+            if (index == 0) {
                 m_direction = 1;
             }
         }
+        moveServo(index);
+    }
 
-        m_servoPositionDegree = servoAngle(m_index);
-        m_servo.setAngle(m_servoPositionDegree);
+    /**
+     * Add the positions sampled since the last call to the map (from the snapshot).
+     */
+    void updateMap()
+    {
+        int newSamples = m_scan.sampleNumber - m_mappedSampleNumber;
+        m_mappedSampleNumber = m_scan.sampleNumber;
+        int threshold = triggerThreshold();
+        for (int i = 0; i < Config::IMAGE_SIZE; i++) {
+            if (m_scan.age[i] < newSamples) {
+                m_map.addMeasurement(servoAngle(i), mapRange(m_scan.image[i]), m_scan.image[i] >= threshold);
+            }
+        }
+    }
 
-        return m_sensorValue;
+    /**
+     * Get the range of the measurement for the map in meters - without the trigger distance
+     * the calibration is not trusted and @{ObstacleMap::Config::detectionRange} is used.
+     *
+     * @param raw value from sensor
+     */
+    float mapRange(int raw) const
+    {
+        if (m_config.triggerDistanceMm == 0) {
+            return m_map.config().detectionRange;
+        }
+        return m_calibration.toMillimeters(raw) / 1000.0f;
+    }
+
+    /**
+     * Get the raw value which triggers the detector (from trigger distance and actual speed).
+     */
+    int triggerThreshold() const
+    {
+        if (m_config.triggerDistanceMm == 0) {
+            return m_config.thresholdDistance;
+        }
+        float speedDistanceMm = m_speed * m_config.triggerTime * 1000;
+        return m_calibration.toRaw(std::max<float>(m_config.triggerDistanceMm, speedDistanceMm));
+    }
+
+    /**
+     * Choose the next position for the adaptive scanning.
+     *
+     * Priority is the age of the position minus the time of the servo move to it in samples
+     * (multiplied for positions in the lane) - a long jump across the range is taken only
+     * for a much older position. Stay on the position
+     * with rising value for @{Config::DWELL_SAMPLES}.
+     */
+    int nextAdaptiveIndex()
+    {
+        if (m_dwell > 0) {
+            m_dwell--;
+            return m_index;
+        }
+        int best = m_index;
+        int bestPriority = INT_MIN;
+        for (int i = 0; i < Config::IMAGE_SIZE; i++) {
+            int priority = (m_sampled.age[i] - travelSamples(i)) * (isInLane(i) ? Config::LANE_WEIGHT : 1);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Get the time to move the servo to the position in the samples (the other positions age meanwhile).
+     *
+     * @param index of the position (the range is define by @{Config::IMAGE_SIZE})
+     */
+    int travelSamples(int index) const
+    {
+        int sampleUs = m_config.oversampling * m_config.sampleIntervalUs;
+        return (settleTimeUs(servoAngle(index)) + sampleUs - 1) / sampleUs;
+    }
+
+    /**
+     * Get the time for the servo to settle at the angle from the actual position.
+     *
+     * @param angle target angle of the servo in degree
+     */
+    int settleTimeUs(int angle) const
+    {
+        return m_config.settleTimeUs + m_config.settleTimePerDegreeUs * nxpcup::abs(angle - m_servoPositionDegree);
+    }
+
+    /**
+     * Save the lane borders from camera as range of the servo angles.
+     *
+     * @param leftBorder positon of left border from border detector
+     * @param rightBorder positon of right border from border detector
+     */
+    void setLane(int leftBorder, int rightBorder)
+    {
+        // camera pixel 0 is on the left side as the servo angles under 90 degree
+        m_laneMinAngle = 90 + ((leftBorder - Config::CAMERA_CENTER) * m_config.cameraFieldOfView) / Config::CAMERA_PIXELS;
+        m_laneMaxAngle = 90 + ((rightBorder - Config::CAMERA_CENTER) * m_config.cameraFieldOfView) / Config::CAMERA_PIXELS;
+    }
+
+    /**
+     * Check if the position is in the lane ahead.
+     */
+    bool isInLane(int index) const
+    {
+        int angle = servoAngle(index);
+        return angle >= m_laneMinAngle && angle <= m_laneMaxAngle;
+    }
+
+    /**
+     * Move the servo to the position and set the time for settling.
+     *
+     * @param index of the position (the range is define by @{Config::IMAGE_SIZE})
+     */
+    void moveServo(int index)
+    {
+        int angle = servoAngle(index);
+        m_settleTicks = settleTimeUs(angle) / m_config.sampleIntervalUs;
+        m_index = index;
+        m_servoPositionDegree = angle;
+        m_servo.setAngle(angle);
+    }
+
+    /**
+     * Calculate the error for the path next to the obstacle.
+     *
+     * The target of the path is the lateral offset next to the obstacles from the map in meters,
+     * without mapped obstacle the border is kept @{Config::moveFromObstacle} from the center.
+     * The planner moves the path smoothly to the target and back, the offset is converted
+     * to pixels by the width of the lane (without @{Config::laneWidth} the path is in pixels).
+     */
+    int avoidingError(int borderDetectorError, int leftBorder, int rightBorder, float encoderDistance)
+    {
+        int side = m_avoidingSide == AvoidingObstacle::onLeftSide ? -1 : 1;
+        if (m_config.laneWidth > 0 && m_map.obstacleSide() != 0) {
+            m_avoidanceOffset = m_map.avoidanceOffset(side); // kept after the obstacle is passed
+            m_hasAvoidanceOffset = true;
+        }
+        float pixelsPerMeter = 1;
+        if (m_config.laneWidth > 0) {
+            pixelsPerMeter = std::max(rightBorder - leftBorder, 1) / m_config.laneWidth;
+        }
+        float target = m_avoidanceOffset;
+        if (!m_hasAvoidanceOffset) {
+            int borderError = side < 0
+                ? leftBorder - (Config::CAMERA_CENTER - m_config.moveFromObstacle) // see just right line
+                : rightBorder - (Config::CAMERA_CENTER + m_config.moveFromObstacle); // see just left line
+            target = (borderError - borderDetectorError) / pixelsPerMeter;
+        }
+        return borderDetectorError + int(m_planner.offset(target, encoderDistance) * pixelsPerMeter);
+    }
+
+    /**
+     * Measure the speed from the encoder distance between the calls of @{error()} (time from @{systemClock()}).
+     */
+    void updateSpeed(float encoderDistance)
+    {
+        uint64_t elapsedUs = systemClock().elapsedUs(m_lastSpeedUs);
+        if (m_isMoving && elapsedUs > 0) {
+            float speed = (encoderDistance - m_lastDistance) * 1000000 / elapsedUs;
+            m_speed += (speed - m_speed) / Config::SPEED_AVERAGE; // moving average - the encoder distance is quantized
+        }
+        m_lastDistance = encoderDistance;
+        m_isMoving = true;
     }
 
     std::optional<int> checkObstacleAngle()
     {
-        Image processed = m_image;
+        Image processed = m_scan.image;
+        for (int i = 0; i < int(processed.size); i++) {
+            if (m_scan.age[i] >= Config::STALE_AGE) {
+                processed[i] = 0;
+            }
+        }
         int maxElementIndex = std::max_element(processed.begin(), processed.end())
             - processed.begin();
 
         int maxElementValue = processed[maxElementIndex];
-        if (maxElementValue < m_config.thresholdDistance) {
+        if (maxElementValue < triggerThreshold()) {
             return {};
         }
         m_distanceThatTriggered = maxElementValue;
@@ -221,31 +527,62 @@ private:
             if (!obstacle) {
                 return;
             }
-            if (*obstacle < 90) {
+            int side = m_map.obstacleSide();
+            if (side == 0) {
+                side = *obstacle < 90 ? -1 : 1;
+            }
+            if (side < 0) {
                 m_avoidingObstacle = AvoidingObstacle::onLeftSide; // see just right line;
             } else {
                 m_avoidingObstacle = AvoidingObstacle::onRightSide; // see just left line
             }
+            m_avoidingSide = m_avoidingObstacle;
+            m_hasAvoidanceOffset = false;
             m_encoderDistanceStart = encoderDistance;
+            m_planner.start(encoderDistance, m_speed);
         } else {
-            if (m_encoderDistanceStart + m_config.encoderAvoidDistance < encoderDistance) {
+            if (m_map.isClear()
+                || m_encoderDistanceStart + m_config.encoderAvoidDistance < encoderDistance) {
                 m_avoidingObstacle = AvoidingObstacle::no;
+                m_planner.finish(encoderDistance, m_speed);
             }
         }
     }
 
-    AnalogIn m_sensor;
+    InterruptAnalogIn m_sensor;
     Servo m_servo;
     Config m_config;
+    Ticker m_sampleTicker;
 
     AvoidingObstacle m_avoidingObstacle = AvoidingObstacle::no;
+    AvoidingObstacle m_avoidingSide = AvoidingObstacle::no; // side of the last obstacle - kept during return
+    float m_avoidanceOffset = 0; // meters from the road center (positive = right)
+    bool m_hasAvoidanceOffset = false;
     float m_encoderDistanceStart = 0;
-    int m_sensorValue = 0;
-    int m_servoPositionDegree = 90;
+    volatile int m_sensorValue = 0;
+    volatile int m_servoPositionDegree = 90;
     int m_direction = 1; // -1 = left; 1 = right
-    int m_index = 0;
+    volatile int m_index = 0;
     int m_distanceThatTriggered = 0;
-    ObstacleImage m_image;
+    Scan m_sampled = {}; // owned by the interrupt
+    Seqlock<Scan> m_published;
+    Scan m_scan = {}; // snapshot for the main loop - taken in @{error()}
+    ObstacleMap m_map;
+    DistanceCalibration m_calibration;
+    AvoidancePlanner m_planner;
+    float m_speed = 0; // measured from encoder in [m/s]
+    float m_lastDistance = 0;
+    uint64_t m_lastSpeedUs = 0;
+    bool m_isMoving = false;
+    uint32_t m_mappedSampleNumber = 0;
+
+    int m_dwell = 0;
+    volatile int m_laneMinAngle = 0;
+    volatile int m_laneMaxAngle = Config::SERVO_MAX_RANGE_DEGREE;
+
+    int m_settleTicks = 0;
+    uint32_t m_sampleSum = 0;
+    uint8_t m_sampleCount = 0;
 };
 
 } // namespace nxpcup
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <array>
+#include <math.h>
+#include <stdint.h>
+
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Occupancy grid of obstacles around the car with fixed memory.
+ *
+ * The grid is aligned with the road: rows go along the road (the car is
+ * in row @{ROWS_BEHIND}), columns go across the road. Rows are shifted
+ * with the distance from encoder, the lateral position and heading of car
+ * are integrated from the steering angle (kinematic bicycle model).
+ */
+class ObstacleMap {
+public:
+    struct Config {
+        float wheelBase = 0.175; /**< distance between front and rear axle in meters **/
+        float detectionRange = 0.3; /**< range of the sensor in meters when the distance is not calibrated (the obstacle is at this distance when triggered) **/
+        float clearance = 0.1; /**< distance behind the car in meters when the obstacle is considered as passed **/
+        float headingDecayDistance = 0.5; /**< the heading returns to the road direction on this distance (the car follows the lane) **/
+    };
+
+    static constexpr int ROWS = 24;
+    static constexpr int ROWS_BEHIND = 8;
+    static constexpr int COLUMNS = 10;
+    static constexpr float CELL_SIZE = 0.05; // meters
+
+    static constexpr uint8_t HIT = 96; // increase of the occupancy for the cell with obstacle
+    static constexpr uint8_t MISS = 32; // decrease of the occupancy for the free cell
+    static constexpr uint8_t OCCUPIED = 128; // minimal occupancy of the cell with obstacle
+
+    /**
+     * Constructor of class ObstacleMap.
+     *
+     * @param config struct @{Config}
+     */
+    ObstacleMap(Config config)
+        : m_config(config)
+    {
+    }
+
+    /**
+     * Move the car in the map.
+     *
+     * @param encoderDistance distance from one encoder in meters
+     * @param steeringAngle angle of the front wheels in degree around center (positive = right)
+     */
+    void move(float encoderDistance, int steeringAngle)
+    {
+        if (!m_isMoving) {
+            m_lastDistance = encoderDistance;
+            m_isMoving = true;
+            return;
+        }
+        float delta = encoderDistance - m_lastDistance;
+        m_lastDistance = encoderDistance;
+
+        m_heading += delta * tanf(steeringAngle * float(M_PI) / 180) / m_config.wheelBase;
+        m_heading -= m_heading * nxpcup::clamp<float>(delta / m_config.headingDecayDistance, 0, 1);
+        m_carLateral = nxpcup::clamp<float>(m_carLateral + delta * sinf(m_heading), -COLUMNS * CELL_SIZE / 2, COLUMNS * CELL_SIZE / 2);
+
+        m_forward += delta * cosf(m_heading);
+        while (m_forward >= CELL_SIZE) {
+            m_forward -= CELL_SIZE;
+            for (int row = 0; row < ROWS - 1; row++) {
+                m_cells[row] = m_cells[row + 1];
+            }
+            m_cells[ROWS - 1].fill(0);
+        }
+    }
+
+    /**
+     * Add measurement of the sensor to the map.
+     *
+     * Cells between the car and the measured distance are free.
+     *
+     * @param sensorAngle direction of the sensor in degree (90 = straight, under 90 = left)
+     * @param range measured distance in meters
+     * @param isHit true if the sensor see the obstacle in the range, else the range is free
+     */
+    void addMeasurement(int sensorAngle, float range, bool isHit)
+    {
+        float angle = (sensorAngle - 90) * float(M_PI) / 180 + m_heading;
+        float dx = cosf(angle) * CELL_SIZE;
+        float dy = sinf(angle) * CELL_SIZE;
+        int steps = range / CELL_SIZE + 0.5f;
+        for (int step = 0; step <= steps; step++) {
+            int row, column;
+            if (!cellAt(step * dx, m_carLateral + step * dy, row, column)) {
+                return;
+            }
+            uint8_t& cell = m_cells[row][column];
+            if (step == steps && isHit) {
+                cell = cell > UINT8_MAX - HIT ? UINT8_MAX : cell + HIT;
+            } else {
+                cell = cell < MISS ? 0 : cell - MISS;
+            }
+        }
+    }
+
+    /**
+     * Find on which side of the car are the obstacles ahead.
+     *
+     * @return -1 = left, 1 = right, 0 = without obstacle
+     */
+    int obstacleSide() const
+    {
+        int left = 0;
+        int right = 0;
+        for (int row = ROWS_BEHIND; row < ROWS; row++) {
+            for (int column = 0; column < COLUMNS; column++) {
+                if (m_cells[row][column] < OCCUPIED) {
+                    continue;
+                }
+                if (columnLateral(column) < m_carLateral) {
+                    left += m_cells[row][column];
+                } else {
+                    right += m_cells[row][column];
+                }
+            }
+        }
+        if (left == 0 && right == 0) {
+            return 0;
+        }
+        return left > right ? -1 : 1;
+    }
+
+    /**
+     * Check if there is no obstacle in front of the car and in the clearance behind it.
+     */
+    bool isClear() const
+    {
+        int firstRow = nxpcup::clamp<int>(ROWS_BEHIND - m_config.clearance / CELL_SIZE, 0, ROWS_BEHIND);
+        for (int row = firstRow; row < ROWS; row++) {
+            for (uint8_t cell : m_cells[row]) {
+                if (cell >= OCCUPIED) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Calculate the lateral position next to the obstacles with the clearance.
+     *
+     * @param side of the obstacles (-1 = left, 1 = right)
+     * @return lateral offset from the road center in meters (positive = right)
+     */
+    float avoidanceOffset(int side) const
+    {
+        float offset = 0;
+        for (int row = ROWS_BEHIND; row < ROWS; row++) {
+            for (int column = 0; column < COLUMNS; column++) {
+                if (m_cells[row][column] < OCCUPIED) {
+                    continue;
+                }
+                float edge = columnLateral(column) - side * (CELL_SIZE / 2 + m_config.clearance);
+                if (side < 0 ? edge > offset : edge < offset) {
+                    offset = edge;
+                }
+            }
+        }
+        return offset;
+    }
+
+    /**
+     * Get the occupancy of one cell (0 = free, 255 = surely occupied).
+     *
+     * @param row along the road (the car is in row @{ROWS_BEHIND})
+     * @param column across the road (left to right)
+     */
+    uint8_t cell(int row, int column) const
+    {
+        return m_cells[row][column];
+    }
+
+    /**
+     * Get lateral position of the car from the road center in meters (positive = right).
+     */
+    float carLateral() const { return m_carLateral; }
+
+    /**
+     * Get the actual configuration of the @{ObstacleMap}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{ObstacleMap}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(const Config& config)
+    {
+        m_config = config;
+        reset();
+    }
+
+    /**
+     * Clear the map.
+     */
+    void reset()
+    {
+        for (auto& row : m_cells) {
+            row.fill(0);
+        }
+        m_isMoving = false;
+        m_forward = 0;
+        m_heading = 0;
+        m_carLateral = 0;
+    }
+
+private:
+    /**
+     * Get lateral position of the column center in meters.
+     */
+    static float columnLateral(int column)
+    {
+        return (column - COLUMNS / 2 + 0.5f) * CELL_SIZE;
+    }
+
+    /**
+     * Find the cell for the position relative to the car (forward) and to the road center (lateral).
+     *
+     * @return false if the position is outside of the map
+     */
+    bool cellAt(float forward, float lateral, int& row, int& column) const
+    {
+        row = ROWS_BEHIND + int(floorf((forward + m_forward) / CELL_SIZE));
+        column = COLUMNS / 2 + int(floorf(lateral / CELL_SIZE));
+        return row >= 0 && row < ROWS && column >= 0 && column < COLUMNS;
+    }
+
+    Config m_config;
+
+    std::array<std::array<uint8_t, COLUMNS>, ROWS> m_cells = {};
+    bool m_isMoving = false;
+    float m_lastDistance = 0;
+    float m_forward = 0; // distance travelled in the actual row
+    float m_heading = 0; // radians from the road direction (positive = right)
+    float m_carLateral = 0;
+};
+
+} // namespace nxpcup
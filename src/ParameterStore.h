@@ -0,0 +1,482 @@
+#pragma once
+
+// Header file with persistent storage of the parameters (calibration, regulator gains)
+//
+// The record (header + parameters) is protected by CRC32 and the version of the parameters.
+// The records are appended to one of two sectors; when the sector is full, the other one
+// is erased and used (wear levelling). Interrupted write never destroys the previous record.
+//
+//     nxpcup::FlashIapBackend flash;
+//     nxpcup::ParameterStore<nxpcup::CarParameters> store(flash, nxpcup::CarParameters::VERSION);
+//     nxpcup::CarParameters parameters;
+//     if (store.load(parameters)) {
+//         borderDetector.setThreshold(parameters.borderThreshold);
+//         camera.setCalibration(&parameters.cameraCalibration); // parameters must exist while used
+//     }
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#include "mbed.h"
+
+#include "BorderDetector.h"
+#include "Camera.h"
+#include "MotorControl.h"
+#include "SteeringControl.h"
+
+namespace nxpcup {
+
+/**
+ * Storage with two erasable sectors (flash or file on the host).
+ */
+class StorageBackend {
+public:
+    static constexpr int SECTORS = 2;
+
+    virtual ~StorageBackend() = default;
+
+    /**
+     * Get size of one sector in bytes.
+     */
+    virtual uint32_t sectorSize() const = 0;
+
+    /**
+     * Get the minimal size (and alignment) of the programmed data in bytes.
+     */
+    virtual uint32_t programSize() const = 0;
+
+    virtual bool read(int sector, uint32_t offset, void* data, uint32_t size) = 0;
+
+    /**
+     * Erase the sector - all bytes are 0xFF.
+     */
+    virtual bool erase(int sector) = 0;
+
+    /**
+     * Program the erased part of the sector.
+     *
+     * @param size multiple of @{programSize()}
+     */
+    virtual bool program(int sector, uint32_t offset, const void* data, uint32_t size) = 0;
+};
+
+#if DEVICE_FLASH
+/**
+ * Two sectors of the internal flash of the microcontroller (mbed FlashIAP).
+ */
+class FlashIapBackend : public StorageBackend {
+public:
+    /**
+     * Constructor of class FlashIapBackend.
+     *
+     * One sector of the backend is made of several physical sectors when they are small
+     * (KL25Z: 1 KB) - more records fit in it and the sector is erased less often.
+     *
+     * @param address start of the first sector (0 = end of the flash)
+     * 		  the sectors must not be used by the program
+     * @param minimalSectorSize minimal size of one sector in bytes
+     */
+    FlashIapBackend(uint32_t address = 0, uint32_t minimalSectorSize = 4096)
+    {
+        m_flash.init();
+        uint32_t end = m_flash.get_flash_start() + m_flash.get_flash_size();
+        uint32_t physicalSize = m_flash.get_sector_size(end - 1);
+        m_sectorSize = (minimalSectorSize + physicalSize - 1) / physicalSize * physicalSize;
+        m_address = address != 0 ? address : end - SECTORS * m_sectorSize;
+    }
+
+    ~FlashIapBackend() { m_flash.deinit(); }
+
+    uint32_t sectorSize() const override { return m_sectorSize; }
+
+    uint32_t programSize() const override { return m_flash.get_page_size(); }
+
+    bool read(int sector, uint32_t offset, void* data, uint32_t size) override
+    {
+        return m_flash.read(data, address(sector, offset), size) == 0;
+    }
+
+    bool erase(int sector) override
+    {
+        return m_flash.erase(address(sector, 0), m_sectorSize) == 0;
+    }
+
+    bool program(int sector, uint32_t offset, const void* data, uint32_t size) override
+    {
+        return m_flash.program(data, address(sector, offset), size) == 0;
+    }
+
+private:
+    uint32_t address(int sector, uint32_t offset) const { return m_address + sector * m_sectorSize + offset; }
+
+    mutable FlashIAP m_flash;
+    uint32_t m_address;
+    uint32_t m_sectorSize;
+};
+#endif
+
+/**
+ * Two sectors in the file - stand-in for the flash on the host (simulation, tests).
+ */
+class FileBackend : public StorageBackend {
+public:
+    /**
+     * Constructor of class FileBackend.
+     *
+     * @param path of the file (created if it doesn't exist)
+     * @param sectorSize size of one sector in bytes
+     */
+    FileBackend(const char* path, uint32_t sectorSize = 4096)
+        : m_sectorSize(sectorSize)
+    {
+        m_file = fopen(path, "r+b");
+        if (!m_file) {
+            m_file = fopen(path, "w+b");
+            for (int sector = 0; m_file && sector < SECTORS; sector++) {
+                erase(sector);
+            }
+        }
+    }
+
+    ~FileBackend()
+    {
+        if (m_file) {
+            fclose(m_file);
+        }
+    }
+
+    uint32_t sectorSize() const override { return m_sectorSize; }
+
+    uint32_t programSize() const override { return 8; }
+
+    bool read(int sector, uint32_t offset, void* data, uint32_t size) override
+    {
+        return seek(sector, offset) && fread(data, 1, size, m_file) == size;
+    }
+
+    bool erase(int sector) override
+    {
+        if (!seek(sector, 0)) {
+            return false;
+        }
+        uint8_t erased[64];
+        memset(erased, 0xFF, sizeof(erased));
+        for (uint32_t written = 0; written < m_sectorSize; written += sizeof(erased)) {
+            fwrite(erased, 1, std::min<uint32_t>(sizeof(erased), m_sectorSize - written), m_file);
+        }
+        return fflush(m_file) == 0;
+    }
+
+    bool program(int sector, uint32_t offset, const void* data, uint32_t size) override
+    {
+        return seek(sector, offset) && fwrite(data, 1, size, m_file) == size && fflush(m_file) == 0;
+    }
+
+private:
+    bool seek(int sector, uint32_t offset)
+    {
+        return m_file && fseek(m_file, sector * m_sectorSize + offset, SEEK_SET) == 0;
+    }
+
+    FILE* m_file;
+    uint32_t m_sectorSize;
+};
+
+/**
+ * Versioned and CRC protected storage of the parameters.
+ *
+ * @tparam T struct with the parameters - trivially copyable (without pointers)
+ */
+template <typename T>
+class ParameterStore {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "parameters must be trivially copyable");
+
+    /**
+     * Constructor of class ParameterStore.
+     *
+     * @param backend storage with two sectors
+     * @param version of the parameters - change it when the struct T changes (old records are ignored)
+     */
+    ParameterStore(StorageBackend& backend, uint16_t version)
+        : m_backend(backend)
+        , m_version(version)
+        , m_slotSize(align(sizeof(Header) + sizeof(T)))
+    {
+    }
+
+    /**
+     * Load the newest valid parameters.
+     *
+     * @param parameters variable for the parameters (unchanged if there is no valid record)
+     * @return false if there is no valid record
+     */
+    bool load(T& parameters)
+    {
+        scan();
+        Slot slot;
+        if (!findNewestValid(slot)) {
+            return false;
+        }
+        return m_backend.read(slot.sector, slot.offset + sizeof(Header), &parameters, sizeof(T));
+    }
+
+    /**
+     * Save the parameters as the newest record.
+     *
+     * @param parameters for saving
+     * @return false if the write failed
+     */
+    bool save(const T& parameters)
+    {
+        if (!m_isScanned) {
+            scan();
+            Slot newest;
+            findNewestValid(newest);
+        }
+        int sector = m_activeSector;
+        uint32_t offset = m_nextOffset[sector];
+        if (offset + m_slotSize > m_backend.sectorSize()) {
+            sector = (sector + 1) % StorageBackend::SECTORS;
+            if (!m_backend.erase(sector)) {
+                return false;
+            }
+            offset = 0;
+        }
+
+        Header header = { MAGIC, m_version, uint16_t(sizeof(T)), m_sequence + 1, 0 };
+        header.crc = ~crc32(headerCrc(header), &parameters, sizeof(T));
+        if (!programSlot(sector, offset, header, parameters)) {
+            m_nextOffset[sector] = offset + m_slotSize; // the slot is not erased anymore
+            return false;
+        }
+
+        m_activeSector = sector;
+        m_nextOffset[sector] = offset + m_slotSize;
+        m_sequence = header.sequence;
+        return true;
+    }
+
+    /**
+     * Erase all records.
+     */
+    bool clear()
+    {
+        bool isErased = true;
+        for (int sector = 0; sector < StorageBackend::SECTORS; sector++) {
+            isErased = m_backend.erase(sector) && isErased;
+            m_nextOffset[sector] = 0;
+        }
+        m_activeSector = 0;
+        m_sequence = 0;
+        m_isScanned = true;
+        return isErased;
+    }
+
+    /**
+     * Get the number of the newest record in the storage (0 = nothing).
+     */
+    uint32_t sequence() const { return m_sequence; }
+
+private:
+    static constexpr uint32_t MAGIC = 0x4E585043; // "NXPC"
+    static constexpr uint32_t ERASED = 0xFFFFFFFF;
+    static constexpr uint32_t CHUNK_SIZE = 64;
+    static constexpr uint32_t MAX_PROGRAM_SIZE = 256; // larger program size of the backend is not supported
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint32_t sequence;
+        uint32_t crc;
+    };
+
+    struct Slot {
+        int sector = 0;
+        uint32_t offset = 0;
+        uint32_t sequence = 0;
+    };
+
+    /**
+     * Get the size of one programmed unit - the slots are aligned to it.
+     */
+    uint32_t programUnit() const
+    {
+        return std::max<uint32_t>(m_backend.programSize(), CHUNK_SIZE);
+    }
+
+    uint32_t align(uint32_t size) const
+    {
+        uint32_t unit = programUnit();
+        return (size + unit - 1) / unit * unit;
+    }
+
+    /**
+     * Find the first free slot in every sector and the highest sequence (only headers are read).
+     */
+    void scan()
+    {
+        m_sequence = 0;
+        for (int sector = 0; sector < StorageBackend::SECTORS; sector++) {
+            uint32_t offset = 0;
+            Header header;
+            while (offset + m_slotSize <= m_backend.sectorSize()
+                && m_backend.read(sector, offset, &header, sizeof(header))
+                && header.magic != ERASED) {
+                if (header.magic == MAGIC) {
+                    m_sequence = std::max(m_sequence, header.sequence);
+                }
+                offset += m_slotSize;
+            }
+            m_nextOffset[sector] = offset;
+        }
+        m_isScanned = true;
+    }
+
+    /**
+     * Find the header with the highest sequence lower than the limit.
+     */
+    bool findNewest(uint32_t below, Slot& newest)
+    {
+        bool isFound = false;
+        for (int sector = 0; sector < StorageBackend::SECTORS; sector++) {
+            for (uint32_t offset = 0; offset < m_nextOffset[sector]; offset += m_slotSize) {
+                Header header;
+                if (!m_backend.read(sector, offset, &header, sizeof(header))) {
+                    continue;
+                }
+                if (header.magic != MAGIC || header.version != m_version || header.size != sizeof(T)) {
+                    continue;
+                }
+                if (header.sequence < below && (!isFound || header.sequence > newest.sequence)) {
+                    newest = { sector, offset, header.sequence };
+                    isFound = true;
+                }
+            }
+        }
+        return isFound;
+    }
+
+    /**
+     * Find the newest record with valid CRC and continue in its sector.
+     */
+    bool findNewestValid(Slot& slot)
+    {
+        uint32_t below = UINT32_MAX;
+        // the newest record could be damaged (interrupted write) - try the older ones
+        while (findNewest(below, slot)) {
+            if (isValid(slot)) {
+                m_activeSector = slot.sector;
+                return true;
+            }
+            below = slot.sequence;
+        }
+        return false;
+    }
+
+    /**
+     * Check the CRC of the record - the parameters are read in chunks (no copy of T on the stack).
+     */
+    bool isValid(const Slot& slot)
+    {
+        Header header;
+        if (!m_backend.read(slot.sector, slot.offset, &header, sizeof(header))) {
+            return false;
+        }
+        uint8_t chunk[CHUNK_SIZE];
+        uint32_t value = headerCrc(header);
+        for (uint32_t position = 0; position < sizeof(T); position += CHUNK_SIZE) {
+            uint32_t size = std::min<uint32_t>(CHUNK_SIZE, sizeof(T) - position);
+            if (!m_backend.read(slot.sector, slot.offset + sizeof(header) + position, chunk, size)) {
+                return false;
+            }
+            value = crc32(value, chunk, size);
+        }
+        return ~value == header.crc;
+    }
+
+    /**
+     * Program the header and parameters in units of @{programUnit()} (the last one padded by 0xFF).
+     */
+    bool programSlot(int sector, uint32_t offset, const Header& header, const T& parameters)
+    {
+        uint32_t unit = programUnit();
+        if (unit > MAX_PROGRAM_SIZE) {
+            return false;
+        }
+        uint8_t chunk[MAX_PROGRAM_SIZE];
+        uint32_t recordSize = sizeof(Header) + sizeof(T);
+        for (uint32_t position = 0; position < recordSize; position += unit) {
+            memset(chunk, 0xFF, unit);
+            for (uint32_t i = position; i < std::min(position + unit, recordSize); i++) {
+                chunk[i - position] = i < sizeof(Header)
+                    ? reinterpret_cast<const uint8_t*>(&header)[i]
+                    : reinterpret_cast<const uint8_t*>(&parameters)[i - sizeof(Header)];
+            }
+            if (!m_backend.program(sector, offset + position, chunk, unit)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * CRC32 of the header without magic and crc (continued by the parameters).
+     */
+    static uint32_t headerCrc(const Header& header)
+    {
+        uint32_t value = ERASED;
+        value = crc32(value, &header.version, sizeof(header.version));
+        value = crc32(value, &header.size, sizeof(header.size));
+        value = crc32(value, &header.sequence, sizeof(header.sequence));
+        return value;
+    }
+
+    /**
+     * CRC32 (polynomial 0xEDB88320) with table of 16 items - small and fast enough.
+     */
+    static uint32_t crc32(uint32_t crc, const void* data, uint32_t size)
+    {
+        static constexpr uint32_t TABLE[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+        };
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (uint32_t i = 0; i < size; i++) {
+            crc ^= bytes[i];
+            crc = (crc >> 4) ^ TABLE[crc & 0x0F];
+            crc = (crc >> 4) ^ TABLE[crc & 0x0F];
+        }
+        return crc;
+    }
+
+    StorageBackend& m_backend;
+    const uint16_t m_version;
+    const uint32_t m_slotSize;
+
+    bool m_isScanned = false;
+    int m_activeSector = 0;
+    uint32_t m_nextOffset[StorageBackend::SECTORS] = {};
+    uint32_t m_sequence = 0;
+};
+
+/**
+ * Parameters of the car which are worth to keep between the starts.
+ *
+ * One record takes 640 B (most of it is the camera calibration) - with 1 KB sectors
+ * every save erases, @{FlashIapBackend} joins the small sectors to 4 KB (6 records).
+ */
+struct CarParameters {
+    static constexpr uint16_t VERSION = 2; // increment with every change of this struct
+
+    BorderDetector::ImageType borderThreshold; /**< @{BorderDetector::threshold()} **/
+    Camera::Calibration cameraCalibration; /**< @{Camera::calibration()} **/
+    MotorControl::Config motorControl; /**< gains of the speed regulators **/
+    SteeringControl::Config steeringControl; /**< gains of the steering regulator **/
+};
+
+} // namespace nxpcup
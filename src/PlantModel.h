@@ -0,0 +1,21 @@
+#pragma once
+
+namespace nxpcup {
+
+/**
+ * Model of the controlled system (plant) - first-order with dead time, optionally second-order,
+ * or integrator with dead time.
+ *
+ * Result of the @{SystemIdentification}, used by the regulators (e.g. @{SteeringControl}).
+ */
+struct PlantModel {
+    float gain = 0; /**< static gain (output units per input unit) **/
+    float timeConstant = 0; /**< time constant in seconds **/
+    float deadTime = 0; /**< transport delay in seconds **/
+    float dampingRatio = 1; /**< damping ratio of the second-order model (1 = first-order) **/
+    float naturalFrequency = 0; /**< natural frequency of the second-order model in rad/s **/
+    bool isIntegrating = false; /**< integrator with dead time - gain is the output rate per input unit in 1/s, timeConstant is 0 **/
+    bool isValid = false;
+};
+
+} // namespace nxpcup
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nxpcup {
+
+/**
+ * Fixed-size queue for one producer and one consumer (e.g. interrupt -> main loop).
+ *
+ * Lock-free: the producer writes only the head, the consumer only the tail
+ * (only atomic load and store - works on Cortex-M0+ too).
+ *
+ * @tparam T type of the items
+ * @tparam N capacity - must be power of two
+ */
+template <typename T, std::size_t N>
+class RingBuffer {
+public:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be power of two");
+
+    /**
+     * Add item to the queue (producer side).
+     *
+     * @return false if the queue is full - item is dropped
+     */
+    bool push(const T& item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        m_data[head % N] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the oldest item from the queue (consumer side).
+     *
+     * @return false if the queue is empty
+     */
+    bool pop(T& item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        item = m_data[tail % N];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Return true if there is no item in the queue.
+     */
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Get number of items in the queue.
+     */
+    std::size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Get maximal number of items in the queue.
+     */
+    static constexpr std::size_t capacity() { return N; }
+
+private:
+    std::array<T, N> m_data;
+    std::atomic<uint32_t> m_head { 0 };
+    std::atomic<uint32_t> m_tail { 0 };
+};
+
+} // namespace nxpcup
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Filter for noisy analog sensors with integer arithmetic and fixed memory.
+ *
+ * Chain: median of last N samples -> exponential moving average ->
+ * threshold with hysteresis and debounce.
+ *
+ * The debounce is an integrating counter: samples over the threshold count up, samples under
+ * (threshold - hysteresis) count down, samples inside the hysteresis band keep it. The trigger is set
+ * when the counter reaches @{Config::debounceCount} and released when it returns to 0,
+ * so a single noisy sample only delays the change instead of restarting it.
+ */
+class SensorFilter {
+public:
+    struct Config {
+        uint8_t medianSize = 3; /**< number of samples for median (1 = without median, max @{MAX_MEDIAN_SIZE}) **/
+        uint8_t averageShift = 1; /**< weight of new sample in moving average is 1 / 2^averageShift (0 = without average) **/
+        uint16_t hysteresis = 2000; /**< the trigger is released under (threshold - hysteresis) **/
+        uint8_t debounceCount = 3; /**< limit of the integrating counter - at least this many samples (more with noise) to change the trigger **/
+    };
+
+    static constexpr int MAX_MEDIAN_SIZE = 7;
+
+    /**
+     * Constructor of class SensorFilter with default configuration.
+     */
+    SensorFilter()
+        : SensorFilter(Config{})
+    {
+    }
+
+    /**
+     * Constructor of class SensorFilter.
+     *
+     * @param config struct @{Config}
+     * @param threshold value which triggers the filter
+     */
+    SensorFilter(Config config, int threshold = 0)
+    {
+        setConfig(config);
+        setThreshold(threshold);
+    }
+
+    /**
+     * Add a new raw sample.
+     *
+     * @param raw value from the sensor
+     * @return filtered value
+     */
+    uint16_t update(uint16_t raw)
+    {
+        if (m_isEmpty) {
+            m_samples.fill(raw);
+            m_accumulator = uint32_t(raw) << m_config.averageShift;
+            m_isEmpty = false;
+        }
+
+        m_samples[m_sampleIndex] = raw;
+        m_sampleIndex = (m_sampleIndex + 1) % m_config.medianSize;
+
+        m_accumulator += median() - (m_accumulator >> m_config.averageShift);
+        m_value = m_accumulator >> m_config.averageShift;
+
+        if (m_value >= m_threshold) {
+            if (m_counter < m_config.debounceCount) {
+                m_counter++;
+            }
+        } else if (m_value < m_threshold - m_config.hysteresis) {
+            if (m_counter > 0) {
+                m_counter--;
+            }
+        }
+        if (m_counter == m_config.debounceCount) {
+            m_isTriggered = true;
+        } else if (m_counter == 0) {
+            m_isTriggered = false;
+        }
+        return m_value;
+    }
+
+    /**
+     * Get the last filtered value.
+     */
+    uint16_t value() const { return m_value; }
+
+    /**
+     * Return true if the filtered value is over the threshold (with hysteresis and debounce).
+     */
+    bool isTriggered() const { return m_isTriggered; }
+
+    /**
+     * Get the confidence of the trigger.
+     *
+     * @return value of the integrating counter, 0 = clearly under threshold, 100 = counter at @{Config::debounceCount}
+     */
+    uint8_t confidence() const
+    {
+        return (m_counter * 100) / m_config.debounceCount;
+    }
+
+    /**
+     * Get the actual threshold.
+     */
+    int threshold() const { return m_threshold; }
+
+    /**
+     * Set the value which triggers the filter.
+     *
+     * @param threshold raw value from sensor
+     */
+    void setThreshold(int threshold) { m_threshold = threshold; }
+
+    /**
+     * Get the actual configuration of the @{SensorFilter}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{SensorFilter}.
+     *
+     * @param config struct @{Config} - out of range values are clamped
+     */
+    void setConfig(const Config& config)
+    {
+        m_config = config;
+        m_config.medianSize = nxpcup::clamp<uint8_t>(m_config.medianSize, 1, MAX_MEDIAN_SIZE);
+        m_config.averageShift = nxpcup::clamp<uint8_t>(m_config.averageShift, 0, 8);
+        m_config.debounceCount = std::max<uint8_t>(m_config.debounceCount, 1);
+        reset();
+    }
+
+    /**
+     * Forget the history of the filter.
+     */
+    void reset()
+    {
+        m_isEmpty = true;
+        m_isTriggered = false;
+        m_sampleIndex = 0;
+        m_counter = 0;
+        m_value = 0;
+    }
+
+private:
+    /**
+     * Get median of the last samples (insertion sort of the small copy).
+     */
+    uint16_t median() const
+    {
+        std::array<uint16_t, MAX_MEDIAN_SIZE> sorted;
+        for (int i = 0; i < m_config.medianSize; i++) {
+            uint16_t value = m_samples[i];
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > value; j--) {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = value;
+        }
+        return sorted[m_config.medianSize / 2];
+    }
+
+    Config m_config;
+    int m_threshold = 0;
+
+    std::array<uint16_t, MAX_MEDIAN_SIZE> m_samples;
+    uint8_t m_sampleIndex = 0;
+    uint32_t m_accumulator = 0;
+    uint16_t m_value = 0;
+    uint8_t m_counter = 0;
+    bool m_isTriggered = false;
+    bool m_isEmpty = true;
+};
+
+} // namespace nxpcup
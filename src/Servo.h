@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
+
 #include "mbed.h"
 
+#include "atoms/numeric/value.h"
+
 #include "util.h"
 
 namespace nxpcup {
@@ -19,9 +23,12 @@ public:
 
         uint32_t minUs = 900; /**< minimal time of servo pulse in microseconds */
         uint32_t maxUs = 2100; /**< maximal time of servo pulse in microseconds */
+        uint16_t slewRate = 0; /**< maximal speed of the output in degree per second (0 = without limit) */
+        uint16_t periodUs = PERIOD_US; /**< period of servo signal - shorter for digital servos (e.g. 3003 = 333 Hz) */
 
         static constexpr uint16_t PERIOD_US = 20000; // 50 Hz
         static constexpr uint16_t CENTER_US = 1500;
+        static constexpr int ANGLE_RESOLUTION = 10; // sub-degree steps in one degree
     };
 
     /**
@@ -30,12 +37,13 @@ public:
      * @param config structure @{Config}
      */
     Servo(Config config)
-        : Servo(config.pin, config.minUs, config.maxUs)
+        : Servo(config.pin, config.minUs, config.maxUs, config.periodUs)
     {
         m_isReverseSignal = config.isReverseSignal;
         setAngleCorrection(config.correctionAngle);
         setAngleMinMaxCenter(config.servoMinMaxAngle);
         setAngleCenter(config.defaultCenterAngle);
+        setSlewRate(config.slewRate);
     }
 
     /**
@@ -44,19 +52,17 @@ public:
      * @param pinName name of the servo pin
      * @param minUs minimal pulse wide (default pulse for 0 degree)
      * @param minUs maximal pulse wide (default pulse for 180 degree)
+     * @param periodUs period of the servo signal (must be longer than maxUs)
      */
-    Servo(PinName pin, uint16_t minUs = 1000, uint16_t maxUs = 2000)
-        : m_minUs(minUs)
+    Servo(PinName pin, uint16_t minUs = 1000, uint16_t maxUs = 2000, uint16_t periodUs = Config::PERIOD_US)
+        : servo(pin)
+        , m_minUs(minUs)
         , m_maxUs(maxUs)
+        , m_periodUs(periodUs)
     {
-#if defined SERVO_HARDWARE_PWM
-        servo = new PwmOut(pin);
-#elif defined SERVO_SOFTWARE_PWM
-        servo = new SoftPWM(pin);
-#endif
-
-        servo->period_us(Config::PERIOD_US);
-        servo->pulsewidth_us(Config::CENTER_US);
+        servo.period_us(m_periodUs);
+        servo.pulsewidth_us(Config::CENTER_US);
+        updatePulseTable();
     }
 
     /**
@@ -64,7 +70,11 @@ public:
      *
      * @param angle which will be add to the set angle
      */
-    void setAngleCorrection(int8_t angle) { m_correctionAngle = angle; }
+    void setAngleCorrection(int8_t angle)
+    {
+        m_correctionAngle = angle;
+        updatePulseTable();
+    }
 
     /**
      * Set minimal and maximal allowed angle.
@@ -76,6 +86,7 @@ public:
     {
         m_minAngle = min + m_correctionAngle;
         m_maxAngle = max + m_correctionAngle;
+        updatePulseTable();
     }
 
     /**
@@ -88,6 +99,29 @@ public:
     {
         m_minAngle = 90 - diffAngle + m_correctionAngle;
         m_maxAngle = 90 + diffAngle + m_correctionAngle;
+        updatePulseTable();
+    }
+
+    /**
+     * Set maximal speed of the servo output.
+     *
+     * The output is then moved by ticker every period of the servo signal
+     * towards the last set angle.
+     *
+     * @param degreePerSecond maximal speed (0 = without limit)
+     */
+    void setSlewRate(uint16_t degreePerSecond)
+    {
+        m_slewTicker.detach();
+        if (degreePerSecond == 0) {
+            m_isSlewLimited = false;
+            setFineAngleImmediately(m_targetFineAngle);
+            return;
+        }
+        int step = std::max<int>(1, (int64_t(degreePerSecond) * Config::ANGLE_RESOLUTION * m_periodUs) / 1000000);
+        m_slewPosition = SlewLimitedAngle(m_outputFineAngle, atoms::Accelerated<int>{ step, step, m_outputFineAngle });
+        m_isSlewLimited = true;
+        m_slewTicker.attach_us(callback(this, &Servo::updateSlew), m_periodUs);
     }
 
     /**
@@ -97,14 +131,31 @@ public:
      */
     void setAngle(uint8_t degree)
     {
-        m_lastAngle = nxpcup::clamp<uint8_t>(degree + m_correctionAngle, m_minAngle, m_maxAngle);
-        uint16_t positionInMicrosecond = 0;
-        if (m_isReverseSignal) {
-            positionInMicrosecond = m_maxUs - (m_lastAngle * usDiff) / 180; // 180 degree = max range
-        } else {
-            positionInMicrosecond = m_minUs + (m_lastAngle * usDiff) / 180; // 180 degree = max range
+        setAngleFine(degree * Config::ANGLE_RESOLUTION);
+    }
+
+    /**
+     * Set position of the servo with sub-degree resolution.
+     *
+     * @param fineAngle in tenths of degree (0 <-> 1800) - clamped
+     */
+    void setAngleFine(int fineAngle)
+    {
+        m_targetFineAngle = nxpcup::clamp<int>(fineAngle, 0, MAX_FINE_ANGLE);
+        if (!m_isSlewLimited) {
+            setFineAngleImmediately(m_targetFineAngle);
         }
-        setMicrosecond(positionInMicrosecond);
+    }
+
+    /**
+     * Set position of the servo around center with sub-degree resolution.
+     *
+     * @param fineAngle in tenths of degree (-900 <-> 900) - clamped
+     * @param reverse the range (0 = 0, 900 => -900, -900 => 900)
+     */
+    void setAngleCenterFine(int fineAngle, bool reverse = false)
+    {
+        setAngleFine(90 * Config::ANGLE_RESOLUTION + ((reverse ? -1 : 1) * fineAngle));
     }
 
     /**
@@ -121,7 +172,17 @@ public:
     /**
      * Get last set angle - value could be clamped in @{angle()}
      */
-    uint8_t angle() const { return m_lastAngle; }
+    uint8_t angle() const
+    {
+        return nxpcup::clamp<int>(m_targetFineAngle / Config::ANGLE_RESOLUTION + m_correctionAngle, m_minAngle, m_maxAngle);
+    }
+
+    /**
+     * Get actual angle on the output in tenths of degree (without correction).
+     *
+     * Differs from the set angle while the slew rate limit is active.
+     */
+    int outputAngleFine() const { return m_outputFineAngle; }
 
     /**
      * Get last center set angle - value could be clamped in @{angle()}
@@ -142,30 +203,90 @@ public:
      */
     int getMaxAngle() const { return m_maxAngle; }
 
+    /**
+     * Get period of the servo signal in microseconds.
+     */
+    uint16_t periodUs() const { return m_periodUs; }
+
 private:
+    using SlewLimitedAngle = atoms::Value<int, atoms::Accelerated>;
+
+    static constexpr int MAX_FINE_ANGLE = 180 * Config::ANGLE_RESOLUTION;
+
+    /**
+     * Precompute the pulse for every degree (correction, min/max and reverse included).
+     */
+    void updatePulseTable()
+    {
+        for (int degree = 0; degree < int(m_pulseTable.size()); degree++) {
+            int angle = nxpcup::clamp<int>(degree + m_correctionAngle, m_minAngle, m_maxAngle);
+            if (m_isReverseSignal) {
+                m_pulseTable[degree] = m_maxUs - (angle * usDiff) / 180; // 180 degree = max range
+            } else {
+                m_pulseTable[degree] = m_minUs + (angle * usDiff) / 180; // 180 degree = max range
+            }
+        }
+    }
+
+    /**
+     * Set the output without the slew rate limit - interpolate the pulse table.
+     *
+     * @param fineAngle in tenths of degree (0 <-> 1800) - not checked
+     */
+    void setFineAngleImmediately(int fineAngle)
+    {
+        m_outputFineAngle = fineAngle;
+        int degree = fineAngle / Config::ANGLE_RESOLUTION;
+        int fraction = fineAngle % Config::ANGLE_RESOLUTION;
+        int pulse = m_pulseTable[degree];
+        if (fraction != 0) {
+            pulse += ((m_pulseTable[degree + 1] - pulse) * fraction) / Config::ANGLE_RESOLUTION;
+        }
+        setMicrosecond(pulse);
+    }
+
+    /**
+     * Move the output towards the set angle - called by ticker.
+     */
+    void updateSlew()
+    {
+        int target = m_targetFineAngle;
+        m_slewPosition = target;
+        if (m_slewPosition.get() != m_outputFineAngle) {
+            setFineAngleImmediately(m_slewPosition);
+        }
+    }
+
     /**
      * Set position (pulse wide) of the servo in microsecond.
      */
     void setMicrosecond(uint16_t microsecond)
     {
-        servo->pulsewidth_us(microsecond);
+        servo.pulsewidth_us(microsecond);
     }
 
 #if defined SERVO_HARDWARE_PWM
-    PwmOut* servo;
+    PwmOut servo;
 #elif defined SERVO_SOFTWARE_PWM
-    SoftPWM* servo;
+    SoftPWM servo;
 #endif
 
     uint8_t m_minAngle = 0;
     uint8_t m_maxAngle = 180;
     int8_t m_correctionAngle = 0;
-    uint8_t m_lastAngle = 0;
     bool m_isReverseSignal = false;
 
     const uint32_t m_minUs;
     const uint32_t m_maxUs;
     const uint32_t usDiff = m_maxUs - m_minUs;
+    const uint16_t m_periodUs;
+
+    std::array<uint16_t, 181> m_pulseTable;
+    volatile int m_targetFineAngle = 90 * Config::ANGLE_RESOLUTION;
+    int m_outputFineAngle = 90 * Config::ANGLE_RESOLUTION;
+    bool m_isSlewLimited = false;
+    SlewLimitedAngle m_slewPosition { 90 * Config::ANGLE_RESOLUTION, atoms::Accelerated<int>{ 0, 0, 0 } };
+    Ticker m_slewTicker;
 };
 
 } // namespace nxpcup
@@ -17,7 +17,7 @@
 
 #include "mbed.h"
 
-#include "SoftPWM.h"
+#include "Clock.h"
 
 namespace nxpcup {
 
@@ -95,7 +95,7 @@ public:
         } else {
             pulse = 1;
         }
-        wait(width);
+        systemClock().waitUs(uint64_t(width * 1000000));
     }
 
     void period(float _period)
@@ -128,6 +128,16 @@ public:
 
     void pulsewidth_us(int _width) { pulsewidth(float(_width) / 1000000); }
 
+    /**
+     * Spread the fraction of the microsecond of the pulse width over the periods
+     * (the mean duty has finer resolution than the timeout).
+     */
+    void dither(bool enable)
+    {
+        dithering = enable;
+        ditherError = 0;
+    }
+
 private:
     Timeout _timeout;
     Ticker _ticker;
@@ -135,6 +145,8 @@ private:
     bool positive;
     float width;
     float interval;
+    bool dithering = false;
+    float ditherError = 0; // fraction of microsecond not used in previous periods
 
     void end()
     {
@@ -149,9 +161,25 @@ private:
     void TickerInterrapt()
     {
         if (width <= 0) {
+            end();
             return;
         }
-        _timeout.attach(callback(this, &SoftPWM::end), width);
+        if (width >= interval) { // full duty - without the gap at the end of the period
+            pulse = positive ? 1 : 0;
+            return;
+        }
+        if (dithering) {
+            float widthUs = width * 1000000 + ditherError;
+            int wholeUs = int(widthUs);
+            ditherError = widthUs - wholeUs;
+            if (wholeUs == 0) {
+                end();
+                return;
+            }
+            _timeout.attach_us(callback(this, &SoftPWM::end), wholeUs);
+        } else {
+            _timeout.attach(callback(this, &SoftPWM::end), width);
+        }
         if (positive) {
             pulse = 1;
         } else {
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include "Clock.h"
+#include "Encoder.h"
+#include "Servo.h"
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Estimator of the vehicle state from both encoders, steering and camera.
+ *
+ * - speed: mean of the encoders with low-pass filter
+ * - yaw rate: blend of the encoder difference and bicycle model from the steering angle
+ * - lateral offset and heading in the lane: Kalman filter, prediction from speed and yaw rate,
+ *   correction by the lane error from camera (looking ahead @{Config::lookAhead})
+ *
+ * Conventions: offset > 0 = car is right from the lane center, heading > 0 = car points right,
+ * yaw rate > 0 = turning right (positive steering angle).
+ */
+class StateEstimator {
+public:
+    struct Config {
+        float wheelBase = 0.175; /**< distance between front and rear axle in meters **/
+        float trackWidth = 0.135; /**< distance between the wheels with encoders in meters **/
+        float steeringRatio = 1; /**< angle of the wheels per degree of the servo **/
+        float speedAlpha = 0.5; /**< weight of the new speed in the low-pass filter (1 = without filter) **/
+        float encoderYawWeight = 0.5; /**< weight of the encoder yaw rate against the bicycle model (0 <-> 1) **/
+        float lookAhead = 0.3; /**< distance from the rear axle to the line seen by camera in meters **/
+        float pixelsPerMeter = 250; /**< lane error per meter of lateral offset at look ahead distance **/
+        int8_t errorSign = -1; /**< sign between lane error and lateral offset (1 for the camera mounted reversed) **/
+        float offsetNoise = 0.05; /**< process noise of the offset in m/sqrt(s) **/
+        float headingNoise = 0.5; /**< process noise of the heading in rad/sqrt(s) (unknown curvature) **/
+        float measurementNoise = 0.01; /**< noise of the lateral offset measured by camera in meters **/
+        float gate = 3; /**< measurements further than gate * sigma from prediction are rejected **/
+    };
+
+    struct State {
+        float speed; /**< speed in [m/s] **/
+        float yawRate; /**< yaw rate in [rad/s] **/
+        float lateralOffset; /**< offset from the lane center in meters **/
+        float heading; /**< angle to the lane in radians **/
+    };
+
+    static constexpr int MAX_REJECTED = 5; // after more rejected measurements the filter is reset to the measurement
+
+    /**
+     * Constructor of class StateEstimator.
+     *
+     * @param config struct @{Config}
+     */
+    StateEstimator(Config config)
+        : m_config(config)
+        , m_lastUpdateUs(systemClock().nowUs())
+    {
+        reset();
+    }
+
+    /**
+     * Update the state - call it every cycle after @{Encoder::update()} and border detection.
+     *
+     * @param leftSpeed speed of left wheel in [m/s]
+     * @param rightSpeed speed of right wheel in [m/s]
+     * @param steeringAngle angle of the servo around center in degrees (positive = right)
+     * @param laneError error from border detector (@{BorderDetector::error()})
+     * @param isLaneValid false if the camera doesn't see the lane - only prediction
+     */
+    void update(float leftSpeed, float rightSpeed, float steeringAngle, int laneError, bool isLaneValid = true)
+    {
+        float dt = systemClock().elapsedUs(m_lastUpdateUs) / 1000000.0f;
+
+        float speed = (leftSpeed + rightSpeed) / 2;
+        m_state.speed += m_config.speedAlpha * (speed - m_state.speed);
+
+        float wheelAngle = steeringAngle * m_config.steeringRatio * float(M_PI / 180);
+        float modelYawRate = m_state.speed * tanf(wheelAngle) / m_config.wheelBase;
+        float encoderYawRate = (leftSpeed - rightSpeed) / m_config.trackWidth;
+        m_state.yawRate = m_config.encoderYawWeight * encoderYawRate + (1 - m_config.encoderYawWeight) * modelYawRate;
+
+        predict(dt);
+        if (isLaneValid) {
+            correct(m_config.errorSign * laneError / m_config.pixelsPerMeter);
+        }
+    }
+
+    /**
+     * Update the state from the actual values of the sensors.
+     *
+     * @param left encoder of left wheel
+     * @param right encoder of right wheel
+     * @param servo steering servo (the output angle is used)
+     * @param laneError error from border detector (@{BorderDetector::error()})
+     * @param isLaneValid false if the camera doesn't see the lane - only prediction
+     */
+    void update(const Encoder& left, const Encoder& right, const Servo& servo, int laneError, bool isLaneValid = true)
+    {
+        float steeringAngle = servo.outputAngleFine() / float(Servo::Config::ANGLE_RESOLUTION) - 90;
+        update(left.speed(), right.speed(), steeringAngle, laneError, isLaneValid);
+    }
+
+    /**
+     * Get the estimated state.
+     */
+    const State& state() const { return m_state; }
+
+    /**
+     * Get the lane error expected from the estimated state - filtered input for the steering regulator.
+     *
+     * @return error in the units of @{BorderDetector::error()}
+     */
+    float laneError() const
+    {
+        return (m_state.lateralOffset + m_config.lookAhead * m_state.heading) * m_config.pixelsPerMeter / m_config.errorSign;
+    }
+
+    /**
+     * Get the standard deviation of the estimated lateral offset in meters.
+     */
+    float lateralOffsetDeviation() const { return sqrtf(m_covariance[0][0]); }
+
+    /**
+     * Get the actual configuration of the @{StateEstimator}.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Set new configuration for @{StateEstimator}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(Config& config)
+    {
+        m_config = config;
+        reset();
+    }
+
+    /**
+     * Reset the state - the car stays in the lane center.
+     */
+    void reset()
+    {
+        m_state = {};
+        m_covariance[0][0] = m_config.measurementNoise * m_config.measurementNoise;
+        m_covariance[0][1] = m_covariance[1][0] = 0;
+        m_covariance[1][1] = 0.1;
+        m_rejected = 0;
+        m_lastUpdateUs = systemClock().nowUs();
+    }
+
+private:
+    /**
+     * Move the offset and heading by speed and yaw rate, increase the uncertainty.
+     */
+    void predict(float dt)
+    {
+        float move = m_state.speed * dt;
+        m_state.lateralOffset += move * m_state.heading;
+        m_state.heading += m_state.yawRate * dt;
+
+        // P = F P F^T + Q, F = [1 move; 0 1]
+        float p00 = m_covariance[0][0] + move * (m_covariance[1][0] + m_covariance[0][1]) + move * move * m_covariance[1][1];
+        float p01 = m_covariance[0][1] + move * m_covariance[1][1];
+        m_covariance[0][0] = p00 + m_config.offsetNoise * m_config.offsetNoise * dt;
+        m_covariance[0][1] = m_covariance[1][0] = p01;
+        m_covariance[1][1] += m_config.headingNoise * m_config.headingNoise * dt;
+    }
+
+    /**
+     * Correct the state by measured offset at look ahead distance (H = [1 lookAhead]).
+     */
+    void correct(float measuredOffset)
+    {
+        float lookAhead = m_config.lookAhead;
+        float ph0 = m_covariance[0][0] + lookAhead * m_covariance[0][1];
+        float ph1 = m_covariance[1][0] + lookAhead * m_covariance[1][1];
+        float variance = ph0 + lookAhead * ph1 + m_config.measurementNoise * m_config.measurementNoise;
+        float innovation = measuredOffset - (m_state.lateralOffset + lookAhead * m_state.heading);
+
+        if (innovation * innovation > m_config.gate * m_config.gate * variance) {
+            if (++m_rejected <= MAX_REJECTED) {
+                return;
+            }
+            // the measurements are consistent, the state is wrong
+            m_state.lateralOffset = measuredOffset;
+            m_state.heading = 0;
+            m_covariance[0][0] = m_config.measurementNoise * m_config.measurementNoise;
+            m_covariance[0][1] = m_covariance[1][0] = 0;
+            m_covariance[1][1] = 0.1;
+            m_rejected = 0;
+            return;
+        }
+        m_rejected = 0;
+
+        float k0 = ph0 / variance;
+        float k1 = ph1 / variance;
+        m_state.lateralOffset += k0 * innovation;
+        m_state.heading += k1 * innovation;
+
+        // P = (I - K H) P
+        float p00 = m_covariance[0][0] - k0 * ph0;
+        float p01 = m_covariance[0][1] - k0 * ph1;
+        float p11 = m_covariance[1][1] - k1 * ph1;
+        m_covariance[0][0] = p00;
+        m_covariance[0][1] = m_covariance[1][0] = p01;
+        m_covariance[1][1] = p11;
+    }
+
+    Config m_config;
+    State m_state = {};
+    float m_covariance[2][2];
+    uint8_t m_rejected = 0;
+    uint64_t m_lastUpdateUs;
+};
+
+} // namespace nxpcup
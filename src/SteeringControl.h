@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "atoms/control/pid.h"
+
+#include "Clock.h"
+#include "PlantModel.h"
+#include "util.h"
+
+namespace nxpcup {
+
+/**
+ * Steering regulator with compensation of the servo delay (Smith predictor).
+ *
+ * The PID regulates the lane error predicted for the moment when the command
+ * takes effect: measured error + (model output now - model output delayed).
+ * The model runs in the real time between the calls (measured by @{systemClock()}).
+ * Without the plant model (@{Config::modelGain} = 0) it works as plain PID.
+ * The predictor of the integrating model (@{Config::modelTimeConstant} = 0) would keep
+ * a constant drift (curve) as offset drift * dead time, so the drift which the model
+ * does not explain is estimated and added to the prediction.
+ */
+class SteeringControl {
+public:
+    struct Config {
+        atoms::Pid<float>::Config pid; /**< PID constants and output range (steering angle) **/
+        float modelGain = 0; /**< plant gain - lane error per degree of steering in steady state (0 = without prediction) **/
+        float modelTimeConstant = 0.1; /**< plant time constant in seconds (0 = integrating plant - modelGain is lane error per degree and second) **/
+        float deadTime = 0.03; /**< delay between command and reaction in seconds (servo period + mechanical lag) **/
+    };
+
+    static constexpr int MAX_DELAY_STEPS = 32; // calls of @{update()} kept for the delayed model output
+    static constexpr float MODEL_REBASE = 1000; // output of the integrating model which is moved to zero
+    static constexpr float DISTURBANCE_TIME_CONSTANT = 0.2; // filter of the drift estimate in seconds
+
+    /**
+     * Constructor of class SteeringControl.
+     *
+     * @param config struct @{Config}
+     */
+    SteeringControl(Config config)
+        : m_pid(config.pid)
+        , m_config(config)
+        , m_lastUpdateUs(systemClock().nowUs())
+    {
+    }
+
+    /**
+     * Calculate new steering angle.
+     *
+     * @param laneError actual error from the border detector
+     * @return steering angle around center (range is defined by @{Config::pid})
+     */
+    float update(float laneError)
+    {
+        uint64_t elapsedUs = systemClock().elapsedUs(m_lastUpdateUs);
+        float period = elapsedUs / 1000000.0f;
+
+        m_predictedError = laneError;
+        if (m_config.modelGain != 0) {
+            m_predictedError += m_modelOutput - delayedModelOutput();
+            if (m_config.modelTimeConstant <= 0) {
+                m_predictedError += estimateDisturbance(laneError, period) * m_config.deadTime;
+            }
+        }
+
+        m_output = m_pid.step(m_predictedError, 0);
+
+        if (m_config.modelGain != 0) {
+            if (m_config.modelTimeConstant > 0) {
+                m_modelOutput += (period / (m_config.modelTimeConstant + period)) * (m_config.modelGain * m_output - m_modelOutput);
+            } else {
+                m_modelOutput += period * m_config.modelGain * m_output;
+                rebaseModel();
+            }
+            m_historyIndex = (m_historyIndex + 1) % m_modelHistory.size();
+            m_modelHistory[m_historyIndex] = { m_modelOutput, uint32_t(m_lastUpdateUs) };
+            m_historyCount = std::min<int>(m_historyCount + 1, m_modelHistory.size());
+        }
+        return m_output;
+    }
+
+    /**
+     * Get the last calculated steering angle.
+     */
+    float output() const { return m_output; }
+
+    /**
+     * Get the lane error predicted for the time when the last command takes effect.
+     */
+    float predictedError() const { return m_predictedError; }
+
+    /**
+     * Set the plant model from the identification (@{SteeringIdentification}).
+     *
+     * @param model identified @{PlantModel}
+     */
+    void setModel(const PlantModel& model)
+    {
+        if (!model.isValid) {
+            return;
+        }
+        m_config.modelGain = model.gain;
+        m_config.modelTimeConstant = model.isIntegrating ? 0 : model.timeConstant;
+        m_config.deadTime = model.deadTime;
+        reset();
+    }
+
+    /**
+     * Get the actual configuration of the @{SteeringControl}.
+     */
+    Config config() const
+    {
+        return m_config;
+    }
+
+    /**
+     * Set new configuration for @{SteeringControl}.
+     *
+     * @param config struct @{Config}
+     */
+    void setConfig(Config& config)
+    {
+        m_config = config;
+        m_pid.set_params(m_config.pid);
+        reset();
+    }
+
+    /**
+     * Reset the regulator and the plant model.
+     */
+    void reset()
+    {
+        m_pid.reset();
+        m_lastUpdateUs = systemClock().nowUs();
+        m_historyCount = 0;
+        m_modelOutput = 0;
+        m_output = 0;
+        m_predictedError = 0;
+        m_disturbance = 0;
+        m_hasModelError = false;
+    }
+
+private:
+    /**
+     * Estimate the drift of the lane error which is not caused by the steering
+     * (measured error - delayed model output), filtered by @{DISTURBANCE_TIME_CONSTANT}.
+     *
+     * @param laneError actual error from the border detector
+     * @param period time since the last call in seconds
+     * @return drift in lane error per second
+     */
+    float estimateDisturbance(float laneError, float period)
+    {
+        float modelError = laneError - delayedModelOutput();
+        if (m_hasModelError && period > 0) {
+            float drift = (modelError - m_lastModelError) / period;
+            m_disturbance += (period / (DISTURBANCE_TIME_CONSTANT + period)) * (drift - m_disturbance);
+        }
+        m_lastModelError = modelError;
+        m_hasModelError = true;
+        return m_disturbance;
+    }
+
+    /**
+     * Move the output of the integrating model and its history near zero
+     * (only the difference is used, the float would lose precision).
+     */
+    void rebaseModel()
+    {
+        if (nxpcup::abs(m_modelOutput) < MODEL_REBASE) {
+            return;
+        }
+        for (auto& sample : m_modelHistory) {
+            sample.output -= m_modelOutput;
+        }
+        m_lastModelError += m_modelOutput;
+        m_modelOutput = 0;
+    }
+
+    struct ModelSample {
+        float output;
+        uint32_t timeUs; // wraps after 71 minutes - only differences are used
+    };
+
+    /**
+     * Get the model output @{Config::deadTime} ago (0 before the first command after reset,
+     * the oldest kept output if the dead time is longer than @{MAX_DELAY_STEPS} calls).
+     */
+    float delayedModelOutput() const
+    {
+        uint32_t nowUs = m_lastUpdateUs;
+        uint32_t deadTimeUs = m_config.deadTime * 1000000;
+        int index = m_historyIndex;
+        for (int i = 0; i < m_historyCount; i++) {
+            const ModelSample& sample = m_modelHistory[index];
+            if (nowUs - sample.timeUs >= deadTimeUs) {
+                return sample.output;
+            }
+            index = (index + m_modelHistory.size() - 1) % m_modelHistory.size();
+        }
+        if (m_historyCount < int(m_modelHistory.size())) {
+            return 0;
+        }
+        return m_modelHistory[(m_historyIndex + 1) % m_modelHistory.size()].output;
+    }
+
+    atoms::Pid<float> m_pid;
+    Config m_config;
+
+    std::array<ModelSample, MAX_DELAY_STEPS + 1> m_modelHistory = {};
+    int m_historyIndex = 0;
+    int m_historyCount = 0;
+    uint64_t m_lastUpdateUs;
+    float m_modelOutput = 0;
+    float m_output = 0;
+    float m_predictedError = 0;
+    float m_disturbance = 0;
+    float m_lastModelError = 0;
+    bool m_hasModelError = false;
+};
+
+} // namespace nxpcup
@@ -0,0 +1,506 @@
+#pragma once
+
+#include <array>
+#include <math.h>
+
+#include "mbed.h"
+
+#include "atoms/control/pid.h"
+
+#include "Camera.h"
+#include "Clock.h"
+
+#include "BorderDetector.h"
+#include "Encoder.h"
+#include "Motor.h"
+#include "MotorControl.h"
+#include "PlantModel.h"
+#include "Servo.h"
+
+namespace nxpcup {
+
+/**
+ * Base class for the identification of the car dynamics.
+ *
+ * Generate the excitation (step or chirp), record the response into RAM
+ * and fit the first/second-order model or the integrator from the recorded data.
+ * Use @{MotorIdentification} or @{SteeringIdentification} on the car, the record can be sent
+ * by @{sendIdentificationDataLorris()} and fitted offline by tools/nxpcup-identify.py.
+ */
+class SystemIdentification {
+public:
+    enum class Excitation {
+        step,
+        chirp
+    };
+
+    struct Config {
+        Excitation excitation = Excitation::step; /**< type of the excitation signal **/
+        int amplitude = 0; /**< amplitude of the excitation - motor power or servo angle in degree (0 = default of the identification) **/
+        int offset = 0; /**< operating point - constant part of the excitation **/
+        uint32_t samplePeriodUs = 5000; /**< expected period of calling @{update()} in microseconds (the fit uses the period measured by @{systemClock()}) **/
+        float outputScale = 1; /**< multiplier of the recorded output (recorded as int16_t) **/
+        float chirpStartHz = 0.5; /**< start frequency of the chirp **/
+        float chirpEndHz = 10; /**< end frequency of the chirp **/
+    };
+
+    struct Sample {
+        int16_t input; /**< applied excitation **/
+        int16_t output; /**< scaled measured response **/
+    };
+
+    using Model = PlantModel;
+
+    static constexpr int MAX_SAMPLES = 400; // 2 s with 5 ms sample period
+    static constexpr int STEP_START = MAX_SAMPLES / 5; // samples before the step
+    static constexpr int MAX_DEAD_TIME_SAMPLES = 10;
+
+    /**
+     * Constructor of class SystemIdentification.
+     *
+     * @param config struct @{Config}
+     */
+    SystemIdentification(Config config)
+        : m_config(config)
+    {
+    }
+
+    /**
+     * Start a new identification - the previous record is discarded.
+     */
+    void start()
+    {
+        m_count = 0;
+        m_isRunning = true;
+    }
+
+    /**
+     * Stop the identification before the record is full.
+     */
+    void stop() { m_isRunning = false; }
+
+    /**
+     * Return true if the identification is still running.
+     */
+    bool isRunning() const { return m_isRunning; }
+
+    /**
+     * Get the excitation for the sample index.
+     *
+     * @param index of the sample (0 <-> @{MAX_SAMPLES})
+     * @return value which is applied to the system
+     */
+    int excitation(int index) const
+    {
+        if (m_config.excitation == Excitation::step) {
+            return m_config.offset + (index < STEP_START ? 0 : m_config.amplitude);
+        }
+        float duration = MAX_SAMPLES * samplePeriod();
+        float t = index * samplePeriod();
+        float phase = 2 * M_PI * (m_config.chirpStartHz * t + (m_config.chirpEndHz - m_config.chirpStartHz) * t * t / (2 * duration));
+        return m_config.offset + int(m_config.amplitude * sinf(phase));
+    }
+
+    /**
+     * Get number of recorded samples.
+     */
+    int sampleCount() const { return m_count; }
+
+    /**
+     * Get the recorded samples - valid are just first @{sampleCount()}.
+     */
+    const std::array<Sample, MAX_SAMPLES>& samples() const { return m_samples; }
+
+    /**
+     * Get the actual configuration of the identification.
+     */
+    Config config() const { return m_config; }
+
+    /**
+     * Fit the first-order model with dead time by least squares.
+     *
+     * Model y[k + 1] = a * y[k] + b * u[k - d] is fitted for every dead time d
+     * (over the same samples) and the one with smallest residual is selected. Works for both excitations.
+     *
+     * @return @{Model} - isValid is false if the data doesn't fit the stable model
+     */
+    Model fitFirstOrder() const
+    {
+        Model best;
+        if (m_count < 2 * MAX_DEAD_TIME_SAMPLES) {
+            return best;
+        }
+
+        float baseline = outputBaseline();
+        float bestResidual = 0;
+        for (int d = 0; d <= MAX_DEAD_TIME_SAMPLES; d++) {
+            float syy = 0, syu = 0, suu = 0, ry = 0, ru = 0, stt = 0;
+            for (int k = MAX_DEAD_TIME_SAMPLES; k < m_count - 1; k++) {
+                float y = m_samples[k].output - baseline;
+                float u = m_samples[k - d].input - m_config.offset;
+                float next = m_samples[k + 1].output - baseline;
+                syy += y * y;
+                syu += y * u;
+                suu += u * u;
+                ry += y * next;
+                ru += u * next;
+                stt += next * next;
+            }
+            float determinant = syy * suu - syu * syu;
+            if (determinant == 0) {
+                continue;
+            }
+            float a = (ry * suu - ru * syu) / determinant;
+            float b = (ru * syy - ry * syu) / determinant;
+            float residual = stt - a * ry - b * ru;
+            if (a <= 0 || a >= 1 || (best.isValid && residual >= bestResidual)) {
+                continue;
+            }
+            best.gain = b / ((1 - a) * m_config.outputScale);
+            best.timeConstant = -samplePeriod() / logf(a);
+            best.deadTime = d * samplePeriod();
+            best.dampingRatio = 1;
+            best.naturalFrequency = 1 / best.timeConstant;
+            best.isValid = true;
+            bestResidual = residual;
+        }
+        return best;
+    }
+
+    /**
+     * Fit the integrator with dead time by least squares (the output drifts with constant input).
+     *
+     * Model y[k + 1] - y[k] = b * u[k - d] is fitted for every dead time d
+     * (over the same samples) and the one with smallest residual is selected.
+     *
+     * @return @{Model} with isIntegrating - isValid is false if the output doesn't follow the input
+     */
+    Model fitIntegrating() const
+    {
+        Model best;
+        if (m_count < 2 * MAX_DEAD_TIME_SAMPLES) {
+            return best;
+        }
+
+        float bestResidual = 0;
+        for (int d = 0; d <= MAX_DEAD_TIME_SAMPLES; d++) {
+            float suu = 0, ru = 0, stt = 0;
+            for (int k = MAX_DEAD_TIME_SAMPLES; k < m_count - 1; k++) {
+                float u = m_samples[k - d].input - m_config.offset;
+                float change = m_samples[k + 1].output - m_samples[k].output;
+                suu += u * u;
+                ru += u * change;
+                stt += change * change;
+            }
+            if (suu == 0) {
+                continue;
+            }
+            float b = ru / suu;
+            float residual = stt - b * ru;
+            if (b == 0 || (best.isValid && residual >= bestResidual)) {
+                continue;
+            }
+            best.gain = b / (samplePeriod() * m_config.outputScale);
+            best.timeConstant = 0;
+            best.deadTime = d * samplePeriod();
+            best.dampingRatio = 1;
+            best.naturalFrequency = 0;
+            best.isIntegrating = true;
+            best.isValid = true;
+            bestResidual = residual;
+        }
+        return best;
+    }
+
+    /**
+     * Fit the second-order model from the overshoot of the step response.
+     *
+     * Fall back to @{fitFirstOrder()} when the excitation is not a step
+     * or the response has no significant overshoot.
+     *
+     * @return @{Model}
+     */
+    Model fitSecondOrder() const
+    {
+        Model model = fitFirstOrder();
+        if (m_config.excitation != Excitation::step || m_count < MAX_SAMPLES || !model.isValid) {
+            return model;
+        }
+
+        float baseline = outputBaseline();
+        float steady = 0;
+        int steadyCount = MAX_SAMPLES / 10;
+        for (int k = MAX_SAMPLES - steadyCount; k < MAX_SAMPLES; k++) {
+            steady += m_samples[k].output;
+        }
+        float delta = steady / steadyCount - baseline;
+        if (delta == 0) {
+            return model;
+        }
+
+        int peakIndex = STEP_START;
+        float peak = 0;
+        for (int k = STEP_START; k < MAX_SAMPLES; k++) {
+            float value = (m_samples[k].output - baseline) / delta;
+            if (value > peak) {
+                peak = value;
+                peakIndex = k;
+            }
+        }
+        float overshoot = peak - 1;
+        // overshoot over 100 % is not a damped oscillation (e.g. drift or unstable response)
+        if (overshoot < 0.02 || overshoot >= 1) {
+            return model;
+        }
+
+        float logOvershoot = logf(overshoot);
+        model.dampingRatio = -logOvershoot / sqrtf(M_PI * M_PI + logOvershoot * logOvershoot);
+        float peakTime = (peakIndex - STEP_START) * samplePeriod() - model.deadTime;
+        if (peakTime <= 0) {
+            return model;
+        }
+        model.naturalFrequency = M_PI / (peakTime * sqrtf(1 - model.dampingRatio * model.dampingRatio));
+        model.timeConstant = 1 / (model.dampingRatio * model.naturalFrequency);
+        return model;
+    }
+
+protected:
+    /**
+     * Save one sample of the identification.
+     *
+     * @param input applied excitation
+     * @param output measured response (multiplied by @{Config::outputScale})
+     * @return false if the record is full
+     */
+    bool record(int input, float output)
+    {
+        if (!m_isRunning || m_count >= MAX_SAMPLES) {
+            m_isRunning = false;
+            return false;
+        }
+        uint64_t nowUs = systemClock().nowUs();
+        if (m_count == 0) {
+            m_firstSampleUs = nowUs;
+        }
+        m_lastSampleUs = nowUs;
+        m_samples[m_count].input = input;
+        m_samples[m_count].output = nxpcup::clamp<float>(output * m_config.outputScale, INT16_MIN, INT16_MAX);
+        m_count++;
+        return true;
+    }
+
+    /**
+     * Get the sample period in seconds - average of the recorded samples
+     * (@{Config::samplePeriodUs} until two samples are recorded).
+     */
+    float samplePeriod() const
+    {
+        if (m_count < 2 || m_lastSampleUs == m_firstSampleUs) {
+            return m_config.samplePeriodUs / 1000000.0;
+        }
+        return (m_lastSampleUs - m_firstSampleUs) / ((m_count - 1) * 1000000.0f);
+    }
+
+    /**
+     * Get the closed-loop time constant for tuning rules (SIMC).
+     */
+    float desiredTimeConstant(const Model& model) const
+    {
+        if (model.isIntegrating) { // without dead time the response is limited by the sampling
+            return std::max(model.deadTime, 4 * samplePeriod());
+        }
+        return model.deadTime > samplePeriod() ? model.deadTime : model.timeConstant / 2;
+    }
+
+    Config m_config;
+
+private:
+    /**
+     * Average output before the excitation starts (or first sample for chirp).
+     */
+    float outputBaseline() const
+    {
+        if (m_config.excitation != Excitation::step) {
+            return m_samples[0].output;
+        }
+        float sum = 0;
+        int count = std::min(m_count, STEP_START);
+        for (int k = 0; k < count; k++) {
+            sum += m_samples[k].output;
+        }
+        return sum / count;
+    }
+
+    std::array<Sample, MAX_SAMPLES> m_samples;
+    int m_count = 0;
+    bool m_isRunning = false;
+    uint64_t m_firstSampleUs = 0;
+    uint64_t m_lastSampleUs = 0;
+};
+
+/**
+ * Identification of the motor speed response (power -> encoder speed).
+ */
+class MotorIdentification : public SystemIdentification {
+public:
+    static constexpr int DEFAULT_AMPLITUDE = 300; // motor power
+    /**
+     * Constructor of class MotorIdentification.
+     *
+     * Output is recorded in [mm/s] - @{Config::outputScale} is overwritten.
+     *
+     * @param motor which will be excited
+     * @param encoder with information about the motor movements
+     * @param config struct @{SystemIdentification::Config}
+     */
+    MotorIdentification(Motor& motor, Encoder& encoder, Config config)
+        : SystemIdentification(config)
+        , m_motor(motor)
+        , m_encoder(encoder)
+    {
+        m_config.outputScale = 1000;
+        if (m_config.amplitude == 0) {
+            m_config.amplitude = DEFAULT_AMPLITUDE;
+        }
+    }
+
+    /**
+     * Apply the next excitation and record the speed.
+     *
+     * Call it with period @{Config::samplePeriodUs} after @{Encoder::update()}.
+     * The motor is stopped when the identification finishes.
+     *
+     * @return true while the identification runs
+     */
+    bool update()
+    {
+        if (!isRunning()) {
+            return false;
+        }
+        int input = excitation(sampleCount());
+        if (!record(input, m_encoder.speed())) {
+            m_motor.power(0);
+            return false;
+        }
+        m_motor.power(input);
+        return true;
+    }
+
+    /**
+     * Suggest the PI gains for @{MotorControl} from the identified model (SIMC rules).
+     *
+     * @param model identified @{Model} - gain in [m/s] per motor power unit
+     * @param base configuration from which the other parameters are copied
+     * @return @{MotorControl::Config}
+     */
+    MotorControl::Config suggestConfig(const Model& model, MotorControl::Config base = {}) const
+    {
+        if (!model.isValid || model.gain <= 0) {
+            return base;
+        }
+        // MotorControl works with normalized output <0.0 - 1.0>
+        float gain = model.gain * m_motor.maxPower();
+        float closedLoop = desiredTimeConstant(model);
+        float proportional = model.timeConstant / (gain * (closedLoop + model.deadTime));
+        float integralTime = std::min(model.timeConstant, 4 * (closedLoop + model.deadTime));
+        base.coefficientP = proportional;
+        // MotorControl integrates coefficientI per its nominal period (@{MotorControl::Config::periodUs})
+        base.coefficientI = proportional * (base.periodUs / 1000000.0f) / integralTime;
+        return base;
+    }
+
+private:
+    Motor& m_motor;
+    Encoder& m_encoder;
+};
+
+/**
+ * Identification of the steering response (servo angle -> border detector error).
+ *
+ * The lane error integrates the steering angle (the angle turns the car, the heading moves it
+ * across the lane) - fit the record by @{fitIntegrating()}. Run it on a straight road with constant
+ * speed (e.g. with @{MotorControl}) in open loop with a small step, the record stops when
+ * the detector loses a border.
+ */
+class SteeringIdentification : public SystemIdentification {
+public:
+    static constexpr int DEFAULT_AMPLITUDE = 3; // degree of the servo
+    /**
+     * Constructor of class SteeringIdentification.
+     *
+     * @param servo for steering which will be excited
+     * @param detector with the actual lane error
+     * @param config struct @{SystemIdentification::Config}
+     */
+    SteeringIdentification(Servo& servo, BorderDetector& detector, Config config)
+        : SystemIdentification(config)
+        , m_servo(servo)
+        , m_detector(detector)
+    {
+        if (m_config.amplitude == 0) {
+            m_config.amplitude = DEFAULT_AMPLITUDE;
+        }
+    }
+
+    /**
+     * Apply the next excitation and record the lane error.
+     *
+     * Call it with period @{Config::samplePeriodUs} after @{BorderDetector::findBorder()}.
+     * The servo returns to the center when the identification finishes or a border is lost.
+     *
+     * @return true while the identification runs
+     */
+    bool update()
+    {
+        if (!isRunning()) {
+            return false;
+        }
+        if (m_detector.leftBorder() == 0 || m_detector.rightBorder() == BorderDetector::Config::RIGHT_BORDER) {
+            stop(); // the car leaves the lane - the error is not measured
+        }
+        int input = excitation(sampleCount());
+        if (!record(input, m_detector.error())) {
+            m_servo.setAngleCenter(0);
+            return false;
+        }
+        m_servo.setAngleCenter(input);
+        return true;
+    }
+
+    /**
+     * Suggest the gains for the steering PID from the identified model (SIMC rules).
+     *
+     * The PID is called with the sample period of the identification.
+     *
+     * @param model identified @{Model} - gain in pixels per degree (per second for the integrator)
+     * @param base configuration from which the limits are copied
+     * @return @{atoms::Pid<float>::Config}
+     */
+    atoms::Pid<float>::Config suggestConfig(const Model& model, atoms::Pid<float>::Config base) const
+    {
+        if (!model.isValid || model.gain == 0) {
+            return base;
+        }
+        float closedLoop = desiredTimeConstant(model);
+        if (model.isIntegrating) { // Kc = 1 / (k * (tauC + theta)), tauI = 4 * (tauC + theta)
+            float proportional = 1 / (model.gain * (closedLoop + model.deadTime));
+            base.p = proportional;
+            base.i = proportional * samplePeriod() / (4 * (closedLoop + model.deadTime));
+            base.d = 0;
+            return base;
+        }
+        float proportional = model.timeConstant / (model.gain * (closedLoop + model.deadTime));
+        float integralTime = std::min(model.timeConstant, 4 * (closedLoop + model.deadTime));
+        float derivativeTime = model.deadTime / 2;
+        base.p = proportional;
+        base.i = proportional * samplePeriod() / integralTime;
+        base.d = proportional * derivativeTime / samplePeriod();
+        return base;
+    }
+
+private:
+    Servo& m_servo;
+    BorderDetector& m_detector;
+};
+
+} // namespace nxpcup
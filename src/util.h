@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stdint.h>
+#include <type_traits>
+
 namespace nxpcup {
 
 template <typename T>
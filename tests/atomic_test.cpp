@@ -0,0 +1,106 @@
+// The lock-free primitives under a writer and readers in threads
+// (built also with the thread sanitizer - the copy of the data must not be a data race).
+
+#include <atomic>
+#include <thread>
+
+#include "Atomic.h"
+
+#include "check.h"
+
+using namespace nxpcup;
+
+/**
+ * All words of the snapshot are written with the same value, the odd size tests the partial word.
+ */
+struct Snapshot {
+    uint32_t words[15];
+    uint8_t last[3];
+};
+
+static void seqlock()
+{
+    constexpr uint32_t WRITES = 200000;
+    Seqlock<Snapshot> published;
+    std::atomic<bool> isWriting { true };
+    std::atomic<int> inconsistent { 0 };
+    std::atomic<int> backwards { 0 };
+
+    std::thread writer([&] {
+        Snapshot snapshot;
+        for (uint32_t value = 1; value <= WRITES; value++) {
+            for (auto& word : snapshot.words) {
+                word = value;
+            }
+            for (auto& byte : snapshot.last) {
+                byte = uint8_t(value);
+            }
+            published.write(snapshot);
+        }
+        isWriting = false;
+    });
+
+    auto reader = [&] {
+        uint32_t previous = 0;
+        do {
+            Snapshot snapshot;
+            published.read(snapshot);
+            for (uint32_t word : snapshot.words) {
+                if (word != snapshot.words[0]) {
+                    inconsistent++;
+                }
+            }
+            for (uint8_t byte : snapshot.last) {
+                if (byte != uint8_t(snapshot.words[0])) {
+                    inconsistent++;
+                }
+            }
+            if (snapshot.words[0] < previous) {
+                backwards++;
+            }
+            previous = snapshot.words[0];
+        } while (isWriting);
+    };
+    std::thread firstReader(reader);
+    std::thread secondReader(reader);
+
+    writer.join();
+    firstReader.join();
+    secondReader.join();
+
+    Snapshot snapshot;
+    published.read(snapshot);
+    CHECK(inconsistent == 0);
+    CHECK(backwards == 0);
+    CHECK(snapshot.words[0] == WRITES);
+    CHECK(published.version() == WRITES);
+}
+
+static void monotonicCounter()
+{
+    constexpr uint32_t EVENTS = 1000000;
+    MonotonicCounter counter;
+    std::atomic<bool> isCounting { true };
+    std::thread writer([&] {
+        for (uint32_t i = 0; i < EVENTS; i++) {
+            counter.increment();
+        }
+        isCounting = false;
+    });
+
+    uint32_t taken = 0;
+    while (isCounting) {
+        taken += counter.take();
+    }
+    writer.join();
+    taken += counter.take();
+    CHECK(taken == EVENTS);
+    CHECK(counter.total() == EVENTS);
+}
+
+int main()
+{
+    seqlock();
+    monotonicCounter();
+    return test::result();
+}
@@ -0,0 +1,191 @@
+// The planned path around the obstacle against the step of the path (the border is switched
+// at the trigger and back): a car with the rate limited servo and the PD regulator follows both
+// paths, the peak steering rate and the distance until the car is back in the lane center are printed.
+// The planned path is always gentler to the servo, it passes faster only at the speed at which
+// the step makes the car oscillate - at lower speed the smooth return costs a few centimeters.
+// The path stays continuous when the target or the side changes.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "AvoidancePlanner.h"
+
+#include "check.h"
+
+using nxpcup::AvoidancePlanner;
+
+constexpr float STEP = 0.005; // meters of the encoder distance per regulation period
+constexpr float OFFSET = 0.25; // offset next to the obstacle in meters
+constexpr float OBSTACLE_LENGTH = 0.6; // distance from the trigger to the start of the return
+
+struct Result {
+    float peakSteeringRate = 0; /**< rad/s **/
+    float backDistance = 0; /**< distance from the trigger until the car stays within 2 cm from the center **/
+    float overshoot = 0; /**< offset to the other side after the return **/
+};
+
+/**
+ * Kinematic bicycle model following the path offset.
+ *
+ * @param isPlanned true - offset from the planner, false - step of the offset
+ * @param speed speed of the car in [m/s]
+ */
+static Result drive(bool isPlanned, float speed)
+{
+    constexpr float WHEELBASE = 0.18;
+    constexpr float MAX_ANGLE = 0.5; // rad
+    constexpr float SERVO_RATE = 10; // rad/s
+    constexpr float LOOKAHEAD = 0.15; // the camera sees the lane ahead of the car
+    constexpr float P = 5;
+    constexpr float D = 0.02;
+
+    AvoidancePlanner planner({});
+    Result result;
+    float dt = STEP / speed;
+    float lateral = 0;
+    float heading = 0;
+    float angle = 0;
+    float lastError = 0;
+    bool isReturning = false;
+    float settledFrom = -1;
+    for (float distance = 0; distance < 4; distance += STEP) {
+        if (!isReturning && distance >= OBSTACLE_LENGTH) {
+            isReturning = true;
+            planner.finish(distance, speed);
+        }
+        if (distance == 0) {
+            planner.start(distance, speed);
+        }
+        float path = isPlanned ? planner.offset(OFFSET, distance) : (isReturning ? 0 : OFFSET);
+
+        float error = path - (lateral + LOOKAHEAD * sinf(heading));
+        float command = P * error + D * (error - lastError) / dt;
+        lastError = error;
+        float wanted = nxpcup::clamp(command, -MAX_ANGLE, MAX_ANGLE);
+        float change = nxpcup::clamp(wanted - angle, -SERVO_RATE * dt, SERVO_RATE * dt);
+        angle += change;
+        result.peakSteeringRate = std::max(result.peakSteeringRate, fabsf(change) / dt);
+
+        heading += STEP * tanf(angle) / WHEELBASE;
+        lateral += STEP * sinf(heading);
+        if (isReturning) {
+            result.overshoot = std::max(result.overshoot, -lateral);
+        }
+
+        if (isReturning && fabsf(lateral) < 0.02) {
+            if (settledFrom < 0) {
+                settledFrom = distance;
+            }
+        } else {
+            settledFrom = -1;
+        }
+    }
+    result.backDistance = settledFrom;
+    return result;
+}
+
+static void comparePaths()
+{
+    for (float speed : { 1.0f, 2.0f, 3.0f }) {
+        Result step = drive(false, speed);
+        Result planned = drive(true, speed);
+        printf("%.1f m/s: peak steering rate %.2f -> %.2f rad/s, back in center after %.2f -> %.2f m, overshoot %.3f -> %.3f m\n",
+            speed, step.peakSteeringRate, planned.peakSteeringRate, step.backDistance, planned.backDistance,
+            step.overshoot, planned.overshoot);
+        CHECK(planned.backDistance > 0);
+        CHECK(planned.peakSteeringRate < step.peakSteeringRate);
+        CHECK(planned.overshoot <= step.overshoot);
+        if (speed >= 3) { // the step saturates the servo - the car oscillates around the center
+            CHECK(planned.backDistance < step.backDistance);
+        } else { // the planned path is longer by the smooth return
+            CHECK(planned.backDistance < step.backDistance + 0.15f);
+        }
+    }
+}
+
+/**
+ * The side is switched during the return and the target moves during the pass - no step of the path,
+ * the jitter of the target within the deadband keeps the path.
+ */
+static void continuity()
+{
+    AvoidancePlanner planner({});
+    float maximalChange = 0;
+    float last = 0;
+    float target = OFFSET;
+    planner.start(0, 1);
+    for (float distance = 0; distance < 2; distance += STEP) {
+        if (fabsf(distance - 0.5f) < STEP / 2) {
+            planner.finish(distance, 1);
+        }
+        if (fabsf(distance - 0.6f) < STEP / 2) { // second obstacle on the other side
+            target = -OFFSET;
+            planner.start(distance, 1);
+        }
+        if (fabsf(distance - 1.0f) < STEP / 2) {
+            target = -OFFSET / 2;
+        }
+        float offset = planner.offset(target, distance);
+        maximalChange = std::max(maximalChange, fabsf(offset - last));
+        last = offset;
+    }
+    printf("continuity: maximal change %.4f m per %.3f m\n", maximalChange, STEP);
+    // steepest part of the approach from one side to the other (a step of the path is 0.25 m and more)
+    CHECK(maximalChange < 0.03);
+    CHECK(fabsf(last + OFFSET / 2) < 0.001);
+
+    // the measured target jitters during the pass - the path does not restart the approach
+    planner.reset();
+    planner.start(0, 1);
+    int restarts = 0;
+    float jitterChange = 0;
+    bool hasPassed = false;
+    last = 0;
+    for (float distance = 0; distance < 1; distance += STEP) {
+        // peak to peak within the deadband
+        float noisy = OFFSET + planner.config().replanDeadband / 2 * (rand() / float(RAND_MAX) * 2 - 1);
+        float offset = planner.offset(noisy, distance);
+        if (hasPassed) {
+            restarts += planner.phase() != AvoidancePlanner::Phase::pass;
+            jitterChange = std::max(jitterChange, fabsf(offset - last));
+        }
+        hasPassed = hasPassed || planner.phase() == AvoidancePlanner::Phase::pass;
+        last = offset;
+    }
+    printf("noisy target: %d restarts of the approach, maximal change %.4f m\n", restarts, jitterChange);
+    CHECK(restarts == 0);
+    CHECK(jitterChange == 0);
+}
+
+/**
+ * The approach is longer at higher speed.
+ */
+static void speedScaling()
+{
+    auto approachLength = [](float speed) {
+        AvoidancePlanner planner({});
+        planner.start(0, speed);
+        float distance = 0;
+        while (planner.phase() == AvoidancePlanner::Phase::approach && distance < 10) {
+            distance += STEP;
+            planner.offset(OFFSET, distance);
+        }
+        return distance;
+    };
+    float slow = approachLength(1);
+    float fast = approachLength(3);
+    printf("approach length: %.3f m at 1 m/s, %.3f m at 3 m/s\n", slow, fast);
+    CHECK(fabsf(slow - 0.2f) < 2 * STEP);
+    CHECK(fabsf(fast - 0.6f) < 2 * STEP);
+    CHECK(fabsf(approachLength(0) - AvoidancePlanner::Config().minimalDistance) < 2 * STEP);
+}
+
+int main()
+{
+    comparePaths();
+    continuity();
+    speedScaling();
+    return test::result();
+}
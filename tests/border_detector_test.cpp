@@ -0,0 +1,175 @@
+// The multiresolution search finds the same borders as the linear search,
+// the adaptive thresholds work with 8-bit pixels and every mode fits the time budget per frame.
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "BorderDetector.h"
+
+#include "check.h"
+
+using nxpcup::BorderDetector;
+using SmallDetector = nxpcup::BasicBorderDetector<uint8_t, 64>;
+
+/**
+ * Lane with borders at the positions on the noisy background, sometimes without one border.
+ */
+static void makeImage(BorderDetector::ImageType* data, int left, int right, bool isLeftVisible, bool isRightVisible)
+{
+    for (int i = 0; i < BorderDetector::Config::dataSize; i++) {
+        data[i] = rand() % 4000;
+    }
+    if (isLeftVisible) {
+        data[left] = 30000 + rand() % 20000;
+    }
+    if (isRightVisible) {
+        data[right] = 30000 + rand() % 20000;
+    }
+}
+
+static void compare(BorderDetector::ThresholdMode thresholdMode)
+{
+    BorderDetector::Config linearConfig;
+    linearConfig.thresholdMode = thresholdMode;
+    BorderDetector::Config multiresolutionConfig = linearConfig;
+    multiresolutionConfig.searchMode = BorderDetector::SearchMode::multiresolution;
+    BorderDetector linear(linearConfig);
+    BorderDetector multiresolution(multiresolutionConfig);
+
+    std::array<BorderDetector::ImageType, BorderDetector::Config::dataSize> data;
+    makeImage(data.data(), 20, 108, true, true);
+    linear.initalize(data, 50);
+    multiresolution.initalize(data, 50);
+
+    int mismatches = 0;
+    int left = 20;
+    int right = 108;
+    for (int frame = 0; frame < 20000; frame++) {
+        if (frame % 50 == 0) { // jump - the borders are lost
+            left = rand() % 60;
+            right = 68 + rand() % 60;
+        } else {
+            left = nxpcup::clamp(left + rand() % 3 - 1, 0, 63);
+            right = nxpcup::clamp(right + rand() % 3 - 1, 64, 127);
+        }
+        makeImage(data.data(), left, right, rand() % 10 != 0, rand() % 10 != 0);
+        if (frame % 97 == 0) { // only noise
+            for (auto& pixel : data) {
+                pixel = rand() % 65536;
+            }
+        }
+        linear.findBorder(data);
+        multiresolution.findBorder(data);
+        mismatches += linear.leftBorder() != multiresolution.leftBorder() || linear.rightBorder() != multiresolution.rightBorder();
+    }
+    CHECK(mismatches == 0);
+}
+
+/**
+ * Short image of 8-bit pixels - the thresholds stay in the pixel range and follow the image.
+ * The bright frames (glare) push the floor of the threshold over the pixel range.
+ */
+static void smallPixels(uint16_t hysteresis, SmallDetector::SearchMode searchMode)
+{
+    SmallDetector::Config config;
+    config.thresholdMode = SmallDetector::ThresholdMode::adaptive;
+    config.searchMode = searchMode;
+    if (hysteresis != 0) {
+        config.hysteresis = hysteresis;
+    }
+    SmallDetector detector(config);
+    std::array<uint8_t, SmallDetector::Config::dataSize> data;
+    int found = 0;
+    int lowThresholds = 0;
+    int wrapped = 0;
+    for (int frame = 0; frame < 250; frame++) {
+        bool isBright = frame < 50;
+        for (auto& pixel : data) {
+            pixel = isBright ? 180 + rand() % 40 : rand() % 16;
+        }
+        data[12] = 250;
+        data[52] = 250;
+        detector.findBorder(data);
+        if (isBright && frame >= 40) {
+            for (int i = 0; i < SmallDetector::Config::dataSize; i++) {
+                wrapped += detector.threshold(i) < 180;
+            }
+        }
+        if (frame >= 150) {
+            found += detector.leftBorder() == 12 && detector.rightBorder() == 52;
+            for (int i = 0; i < SmallDetector::Config::dataSize; i++) {
+                lowThresholds += detector.threshold(i) < 16;
+            }
+        }
+    }
+    printf("8-bit pixels (hysteresis %d): borders found in %d of 100 frames, thresholds %d %d\n",
+        config.hysteresis, found, detector.threshold(12), detector.threshold(30));
+    CHECK(wrapped == 0);
+    CHECK(found == 100);
+    CHECK(lowThresholds == 0);
+}
+
+/**
+ * Time of @{findBorder()} per frame for the mode - the borders are lost every 4th frame.
+ *
+ * @return nanoseconds per frame on host
+ */
+static long long frameTime(BorderDetector::ThresholdMode thresholdMode, BorderDetector::SearchMode searchMode)
+{
+    constexpr int FRAMES = 20000;
+    constexpr int IMAGES = 64;
+    static std::array<BorderDetector::ImageType, BorderDetector::Config::dataSize> images[IMAGES];
+    for (int i = 0; i < IMAGES; i++) {
+        int shift = i % 4 == 0 ? 40 : 0; // jump - search in the whole half
+        makeImage(images[i].data(), (20 + i + shift) % 64, 108 - (i + shift) % 64, true, true);
+    }
+    BorderDetector::Config config;
+    config.thresholdMode = thresholdMode;
+    config.searchMode = searchMode;
+    BorderDetector detector(config);
+    detector.initalize(images[0], 50);
+
+    int checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        detector.findBorder(images[frame % IMAGES]);
+        checksum += detector.leftBorder();
+    }
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    CHECK(checksum > 0);
+    return nanoseconds / FRAMES;
+}
+
+/**
+ * The budget is 10 % of the 16 ms frame on the KL25Z (48 MHz), the host is taken as 100 times faster.
+ */
+static void benchmark()
+{
+    constexpr long long BUDGET_NS = 16000;
+    using ThresholdMode = BorderDetector::ThresholdMode;
+    using SearchMode = BorderDetector::SearchMode;
+    long long fixedLinear = frameTime(ThresholdMode::fixed, SearchMode::linear);
+    long long fixedMultiresolution = frameTime(ThresholdMode::fixed, SearchMode::multiresolution);
+    long long adaptiveLinear = frameTime(ThresholdMode::adaptive, SearchMode::linear);
+    long long adaptiveMultiresolution = frameTime(ThresholdMode::adaptive, SearchMode::multiresolution);
+    printf("ns/frame: fixed linear %lld, fixed multiresolution %lld, adaptive linear %lld, adaptive multiresolution %lld (budget %lld)\n",
+        fixedLinear, fixedMultiresolution, adaptiveLinear, adaptiveMultiresolution, BUDGET_NS);
+    CHECK(fixedLinear < BUDGET_NS);
+    CHECK(fixedMultiresolution < BUDGET_NS);
+    CHECK(adaptiveLinear < BUDGET_NS);
+    CHECK(adaptiveMultiresolution < BUDGET_NS);
+}
+
+int main()
+{
+    compare(BorderDetector::ThresholdMode::fixed);
+    compare(BorderDetector::ThresholdMode::adaptive);
+    CHECK(SmallDetector::Config().hysteresis == 1);
+    smallPixels(0, SmallDetector::SearchMode::linear);
+    smallPixels(4, SmallDetector::SearchMode::linear);
+    smallPixels(4, SmallDetector::SearchMode::multiresolution);
+    benchmark();
+    return test::result();
+}
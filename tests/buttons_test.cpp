@@ -0,0 +1,67 @@
+// The buttons change the state after exactly debounceCount equal samples (the first
+// changed sample counts), a glitch restarts the counting; the events follow the state.
+
+#include "mbed.h"
+
+#include "Buttons.h"
+
+#include "check.h"
+
+using nxpcup::Buttons;
+
+static constexpr PinName PIN = PTC1;
+static constexpr uint16_t PERIOD_US = 10000;
+static constexpr uint8_t DEBOUNCE = 3;
+static constexpr uint16_t RELEASED = 65535;
+static constexpr uint16_t BUTTON_2 = 30000; // between the boundaries 20000 and 40000
+
+static void samples(int count)
+{
+    host::advance(uint64_t(count) * PERIOD_US);
+}
+
+static bool nextEvent(Buttons& buttons, Buttons::Event::Type type, nxpcup::ButtonId id)
+{
+    Buttons::Event event;
+    return buttons.pollEvent(event) && event.type == type && event.id == id;
+}
+
+int main()
+{
+    host::setAnalog(PIN, RELEASED);
+    Buttons::Config config = { PIN, { { 3, 60000 }, { 1, 20000 }, { 2, 40000 } }, PERIOD_US, DEBOUNCE, 800 };
+    Buttons buttons(config);
+    samples(DEBOUNCE);
+    CHECK(buttons.getPressed() == Buttons::NO_BUTTON);
+
+    host::setAnalog(PIN, BUTTON_2);
+    samples(DEBOUNCE - 1);
+    CHECK(buttons.getPressed() == Buttons::NO_BUTTON);
+    samples(1);
+    CHECK(buttons.getPressed() == 2);
+    CHECK(nextEvent(buttons, Buttons::Event::Type::press, 2));
+
+    // one released sample restarts the counting
+    host::setAnalog(PIN, RELEASED);
+    samples(1);
+    host::setAnalog(PIN, BUTTON_2);
+    samples(DEBOUNCE);
+    CHECK(buttons.getPressed() == 2);
+    host::setAnalog(PIN, RELEASED);
+    samples(DEBOUNCE - 1);
+    CHECK(buttons.getPressed() == 2);
+    samples(1);
+    CHECK(buttons.getPressed() == Buttons::NO_BUTTON);
+    CHECK(nextEvent(buttons, Buttons::Event::Type::release, 2));
+
+    // long press after 800 ms of the debounced state
+    host::setAnalog(PIN, 10000);
+    samples(DEBOUNCE);
+    CHECK(nextEvent(buttons, Buttons::Event::Type::press, 1));
+    samples(800000 / PERIOD_US - 1);
+    Buttons::Event event;
+    CHECK(!buttons.pollEvent(event));
+    samples(1);
+    CHECK(nextEvent(buttons, Buttons::Event::Type::longPress, 1));
+    return test::result();
+}
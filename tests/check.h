@@ -0,0 +1,34 @@
+#pragma once
+
+// Minimal checks for the host tests - the failed check is printed and the test fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline int result()
+{
+    if (failures() != 0) {
+        printf("%d check(s) failed\n", failures());
+        return EXIT_FAILURE;
+    }
+    printf("OK\n");
+    return EXIT_SUCCESS;
+}
+
+} // namespace test
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test::failures()++;                                                   \
+        }                                                                         \
+    } while (false)
@@ -0,0 +1,141 @@
+// Parsing of the commands, batched setConfig() and non-blocking replies of the command channel.
+
+#include "mbed.h"
+
+#include "BorderDetector.h"
+#include "CommandChannel.h"
+#include "Log.h"
+
+#include "check.h"
+
+using Channel = nxpcup::CommandChannel;
+
+struct Target {
+    struct Config {
+        float p = 1;
+        int16_t limit = 5;
+        bool isEnabled = false;
+        uint8_t values[32] = {};
+    };
+
+    const Config& config() const { return m_config; }
+
+    void setConfig(Config& config)
+    {
+        m_config = config;
+        applied++;
+    }
+
+    Config m_config;
+    int applied = 0;
+};
+
+static uint8_t crc8(uint8_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    for (int bit = 0; bit < 8; bit++) {
+        crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static void send(RawSerial& serial, uint8_t command, std::initializer_list<uint8_t> data, bool isDamaged = false)
+{
+    uint8_t packet[Channel::MAX_PACKET] = { Channel::HEADER, command, uint8_t(data.size()) };
+    uint8_t crc = crc8(crc8(0, command), data.size());
+    int length = 3;
+    for (uint8_t byte : data) {
+        packet[length++] = byte;
+        crc = crc8(crc, byte);
+    }
+    packet[length++] = isDamaged ? crc ^ 1 : crc;
+    serial.receive(packet, length);
+}
+
+/**
+ * Count the valid packets with the command in the transmitted data.
+ */
+static int countPackets(const RawSerial& serial, uint8_t command)
+{
+    int count = 0;
+    for (int i = 0; i + 3 < serial.txLength;) {
+        int length = serial.tx[i + 2];
+        uint8_t crc = crc8(crc8(0, serial.tx[i + 1]), length);
+        for (int j = 0; j < length; j++) {
+            crc = crc8(crc, serial.tx[i + 3 + j]);
+        }
+        CHECK(serial.tx[i] == Channel::HEADER);
+        CHECK(serial.tx[i + 3 + length] == crc);
+        count += serial.tx[i + 1] == command;
+        i += length + 4;
+    }
+    return count;
+}
+
+int main()
+{
+    RawSerial serial(PTE22, PTE23, 115200);
+    Target target;
+    nxpcup::ConfigBinding<Target> binding(target);
+    Channel channel(serial);
+    CHECK(channel.add("p", binding, binding.config().p));
+    CHECK(channel.add("limit", binding, binding.config().limit));
+    CHECK(channel.add("enabled", binding, binding.config().isEnabled));
+
+    // values are applied together by one setConfig()
+    float p = 2.5f;
+    uint8_t pBytes[4];
+    memcpy(pBytes, &p, 4);
+    send(serial, Channel::SET_PARAMETER, { 0, pBytes[0], pBytes[1], pBytes[2], pBytes[3] });
+    send(serial, Channel::SET_PARAMETER, { 1, 0xFF, 0xFF, 0xFF, 0xF6 });
+    send(serial, Channel::SET_PARAMETER, { 2, 0, 0, 0, 1 }, true);
+    CHECK(target.applied == 0);
+    channel.poll();
+    serial.transmit();
+    CHECK(target.applied == 1);
+    CHECK(target.config().p == 2.5f);
+    CHECK(target.config().limit == -10);
+    CHECK(!target.config().isEnabled);
+    CHECK(channel.crcErrors() == 1);
+    CHECK(countPackets(serial, Channel::PARAMETER_VALUE) == 2);
+
+    // errors
+    serial.txLength = 0;
+    send(serial, Channel::SET_PARAMETER, { 9, 0, 0, 0, 1 });
+    send(serial, Channel::GET_PARAMETER, { 0, 0 });
+    send(serial, 0x55, {});
+    channel.poll();
+    serial.transmit();
+    CHECK(countPackets(serial, Channel::ERROR_REPLY) == 3);
+    CHECK(target.applied == 1);
+
+    // the list of many parameters is spread over several polls, one poll never fills more than the queue
+    for (int i = 3; i < Channel::MAX_PARAMETERS; i++) {
+        CHECK(channel.add("value.with.long.name", binding, binding.config().values[i]));
+    }
+    CHECK(!channel.add("overflow", binding, binding.config().values[0]));
+    serial.txLength = 0;
+    send(serial, Channel::LIST_PARAMETERS, {});
+    send(serial, Channel::GET_PARAMETER, { 1 });
+    int polls = 0;
+    while (countPackets(serial, Channel::PARAMETER_VALUE) == 0 && polls < 100) {
+        int before = serial.txLength;
+        channel.poll();
+        serial.transmit();
+        CHECK(serial.txLength - before <= Channel::TRANSMIT_QUEUE_SIZE);
+        polls++;
+    }
+    CHECK(polls > 1);
+    CHECK(countPackets(serial, Channel::PARAMETER_INFO) == Channel::MAX_PARAMETERS);
+    CHECK(countPackets(serial, Channel::PARAMETER_VALUE) == 1);
+
+    // logging shares the queue with the replies
+    serial.txLength = 0;
+    nxpcup::BorderDetector detector({});
+    sendDetectorDataLorris(channel, detector);
+    serial.transmit();
+    CHECK(serial.txLength == 12);
+    CHECK(serial.tx[0] == 0x80 && serial.tx[1] == 0x02);
+
+    return test::result();
+}
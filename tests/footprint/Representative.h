@@ -0,0 +1,27 @@
+#pragma once
+
+// The representative configuration of the car split to translation units by the features
+// (the size of every object file is printed by the memory_footprint target).
+
+#include "mbed.h"
+
+#include "BorderDetector.h"
+#include "Encoder.h"
+#include "Motor.h"
+#include "Servo.h"
+
+namespace representative {
+
+extern nxpcup::Motor motorLeft;
+extern nxpcup::Encoder encoderLeft;
+extern nxpcup::Servo servo;
+extern nxpcup::BorderDetector detector;
+
+void driveCycle(int error);
+int cameraCycle();
+int obstacleCycle(int error);
+void identificationCycle();
+void storageCycle();
+void telemetryCycle();
+
+} // namespace representative
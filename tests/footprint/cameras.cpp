@@ -0,0 +1,26 @@
+#include "Representative.h"
+
+#include "Camera.h"
+#include "ImagePipeline.h"
+
+namespace representative {
+
+nxpcup::Camera nearCamera(nxpcup::Camera::Config { PTC2, PTB9, PTB8, 4000 });
+nxpcup::Camera farCamera(nxpcup::Camera::Config { PTB10, PTB9, PTB8, 4000 });
+nxpcup::Camera::Calibration nearCalibration;
+nxpcup::Camera::Calibration farCalibration;
+nxpcup::BorderDetector detector({});
+nxpcup::Image<uint16_t, 128> processed;
+
+int cameraCycle()
+{
+    nearCamera.setCalibration(&nearCalibration);
+    farCamera.setCalibration(&farCalibration);
+    nearCamera.update();
+    farCamera.update();
+    nxpcup::pipeline::from(nearCamera.image()).smooth().difference().abs().materialize(processed);
+    detector.findBorder(processed);
+    return detector.error();
+}
+
+} // namespace representative
@@ -0,0 +1,28 @@
+#include "Representative.h"
+
+#include "MotorControl.h"
+#include "SteeringControl.h"
+
+namespace representative {
+
+nxpcup::Motor motorLeft(nxpcup::Motor::Config { PTA4, PTA5 });
+nxpcup::Motor motorRight(nxpcup::Motor::Config { PTC9, PTC8 });
+nxpcup::Encoder encoderLeft(nxpcup::Encoder::Config { PTD4 });
+nxpcup::Encoder encoderRight(nxpcup::Encoder::Config { PTD6 });
+nxpcup::MotorControl motorControlLeft(motorLeft, encoderLeft, {});
+nxpcup::MotorControl motorControlRight(motorRight, encoderRight, {});
+nxpcup::Servo servo(nxpcup::Servo::Config { PTA12, 0, 45 });
+nxpcup::SteeringControl steering(nxpcup::SteeringControl::Config { { 2.5, 0, 0.8, -45, 45 } });
+
+void driveCycle(int error)
+{
+    encoderLeft.update();
+    encoderRight.update();
+    motorControlLeft.setSpeed(1.0);
+    motorControlRight.setSpeed(1.0);
+    motorControlLeft.regulate();
+    motorControlRight.regulate();
+    servo.setAngleCenter(steering.update(error));
+}
+
+} // namespace representative
@@ -0,0 +1,16 @@
+#include "Representative.h"
+
+#include "SystemIdentification.h"
+
+namespace representative {
+
+nxpcup::MotorIdentification motorIdentification(motorLeft, encoderLeft, {});
+nxpcup::SteeringIdentification steeringIdentification(servo, detector, {});
+
+void identificationCycle()
+{
+    motorIdentification.update();
+    steeringIdentification.update();
+}
+
+} // namespace representative
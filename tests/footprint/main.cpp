@@ -0,0 +1,22 @@
+// The representative configuration with the RAM budget checked in compile time
+// (NXPCUP_RAM_BUDGET is set by the memory_footprint target).
+
+#include "MemoryFootprint.h"
+
+#include "Representative.h"
+
+int main()
+{
+    for (int cycle = 0; cycle < 10; cycle++) {
+        int error = representative::cameraCycle();
+        error = representative::obstacleCycle(error);
+        representative::driveCycle(error);
+        representative::identificationCycle();
+        representative::telemetryCycle();
+        host::advance(16000);
+    }
+    representative::storageCycle();
+    printf("representative: %u B of %u B budget\n", static_cast<unsigned>(nxpcup::footprint::REPRESENTATIVE),
+        static_cast<unsigned>(NXPCUP_RAM_BUDGET));
+    return 0;
+}
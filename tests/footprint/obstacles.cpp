@@ -0,0 +1,14 @@
+#include "Representative.h"
+
+#include "ObstacleDetectorWithServo.h"
+
+namespace representative {
+
+nxpcup::ObstacleDetectorWithServo scanningDetector({ PTB7, { PTA13, 0, 60 }, 48000, 15, 0.8 });
+
+int obstacleCycle(int error)
+{
+    return scanningDetector.error(encoderLeft.distance(), error, detector.leftBorder(), detector.rightBorder());
+}
+
+} // namespace representative
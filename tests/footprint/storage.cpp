@@ -0,0 +1,18 @@
+#include "Representative.h"
+
+#include "ParameterStore.h"
+
+namespace representative {
+
+nxpcup::FileBackend backend("memory_footprint.bin");
+nxpcup::ParameterStore<nxpcup::CarParameters> store(backend, nxpcup::CarParameters::VERSION);
+nxpcup::CarParameters parameters;
+
+void storageCycle()
+{
+    if (!store.load(parameters)) {
+        store.save(parameters);
+    }
+}
+
+} // namespace representative
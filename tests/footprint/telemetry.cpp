@@ -0,0 +1,18 @@
+#include "Representative.h"
+
+#include "CommandChannel.h"
+#include "Log.h"
+
+namespace representative {
+
+Serial pc(PTA25, PTA26, 115200);
+RawSerial bluetooth(PTE22, PTE23, 115200);
+nxpcup::CommandChannel channel(bluetooth);
+
+void telemetryCycle()
+{
+    sendDetectorDataLorris(channel, detector);
+    channel.poll();
+}
+
+} // namespace representative
@@ -0,0 +1,177 @@
+// The library must not allocate on the heap after initialization.
+//
+// operator new and malloc (wrapped by the linker) count the allocations during
+// a simulated run of the whole car (camera, detectors, regulators, background tickers).
+
+#include <new>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "Battery.h"
+#include "BorderDetector.h"
+#include "Buttons.h"
+#include "Camera.h"
+#include "CommandChannel.h"
+#include "Encoder.h"
+#include "ImagePipeline.h"
+#include "LaneTracker.h"
+#include "Log.h"
+#include "Motor.h"
+#include "MotorControl.h"
+#include "ObstacleDetector.h"
+#include "ObstacleDetectorWithServo.h"
+#include "Servo.h"
+#include "StateEstimator.h"
+#include "SteeringControl.h"
+
+#include "check.h"
+
+static int allocations = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size)
+{
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+}
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if (void* pointer = __real_malloc(size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+void operator delete[](void* pointer) noexcept { free(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept { free(pointer); }
+
+void operator delete[](void* pointer, std::size_t) noexcept { free(pointer); }
+
+// lane with borders at 20 and 108 pixels, read pixel by pixel by the camera
+static int cameraPixel = 0;
+
+static uint16_t cameraSource()
+{
+    int index = cameraPixel++ % 128;
+    return (index > 17 && index < 23) || (index > 105 && index < 111) ? 60000 : 8000;
+}
+
+int main()
+{
+    host::setAnalogSource(PTC2, cameraSource);
+    host::setAnalog(PTB2, 1000);
+    host::setAnalog(PTB3, 1000);
+    host::setAnalog(PTB7, 1000);
+    host::setAnalog(PTC0, 65535);
+    host::setAnalog(PTC1, 30000);
+
+    nxpcup::Motor motorLeft(nxpcup::Motor::Config { PTA4, PTA5 });
+    nxpcup::Motor motorRight(nxpcup::Motor::Config { PTC9, PTC8 });
+    nxpcup::Encoder encoderLeft(nxpcup::Encoder::Config { PTD4 });
+    nxpcup::Encoder encoderRight(nxpcup::Encoder::Config { PTD6 });
+    nxpcup::MotorControl motorControlLeft(motorLeft, encoderLeft, {});
+    nxpcup::MotorControl motorControlRight(motorRight, encoderRight, {});
+    nxpcup::Servo servo(nxpcup::Servo::Config { PTA12, 0, 45 });
+    nxpcup::SteeringControl steering(nxpcup::SteeringControl::Config { { 2.5, 0, 0.8, -45, 45 } });
+
+    nxpcup::Camera camera(nxpcup::Camera::Config { PTC2, PTB9, PTB8, 4000 });
+    static nxpcup::Camera::Calibration calibration;
+    calibration.offset.fill(1000);
+    calibration.gain.fill(nxpcup::Camera::Calibration::GAIN_ONE);
+    calibration.isValid = true;
+    camera.setCalibration(&calibration);
+    nxpcup::BorderDetector::Config detectorConfig;
+    detectorConfig.thresholdMode = nxpcup::BorderDetector::ThresholdMode::adaptive;
+    detectorConfig.searchMode = nxpcup::BorderDetector::SearchMode::multiresolution;
+    nxpcup::BorderDetector detector(detectorConfig);
+    nxpcup::LaneTracker tracker({});
+    nxpcup::StateEstimator estimator({});
+    nxpcup::Image<uint16_t, 128> processed;
+
+    nxpcup::ObstacleDetector::Config obstacleConfig { PTB2, PTB3, 23000, 18, 0.8 };
+    nxpcup::ObstacleDetector obstacleDetector(obstacleConfig);
+    nxpcup::ObstacleDetectorWithServo scanningDetector({ PTB7, { PTA13, 0, 60 }, 48000, 15, 0.8 });
+
+    nxpcup::Buttons buttons({ PTC0, { { 3, 3840 }, { 2, 40448 }, { 4, 47104 } } });
+    nxpcup::Battery battery({ PTC1 });
+    motorLeft.setBattery(&battery);
+    motorRight.setBattery(&battery);
+
+    RawSerial bluetooth(PTE22, PTE23, 115200);
+    nxpcup::ConfigBinding<nxpcup::MotorControl> motorBinding(motorControlLeft);
+    nxpcup::CommandChannel channel(bluetooth);
+    channel.add("motor.p", motorBinding, motorBinding.config().coefficientP);
+
+    camera.update();
+    detector.initalize(camera.image());
+
+    int initializationAllocations = allocations;
+    allocations = 0;
+
+    const uint8_t getParameter[] = { 0x80, 0x21, 0x01, 0x00, 0x3D };
+    for (int cycle = 0; cycle < 1000; cycle++) {
+        for (int pulse = 0; pulse < 10; pulse++) {
+            host::rise(PTD4);
+            host::rise(PTD6);
+        }
+        camera.update();
+        nxpcup::pipeline::from(camera.image()).smooth().difference().abs().materialize(processed);
+        detector.findBorder(processed);
+        tracker.update(processed.data, 0.01f, servo.centerAngle());
+
+        encoderLeft.update();
+        encoderRight.update();
+        motorControlLeft.setSpeed(1.0);
+        motorControlRight.setSpeed(1.0);
+        motorControlLeft.regulate();
+        motorControlRight.regulate();
+
+        int error = obstacleDetector.error(encoderLeft.distance(), detector.error(), detector.leftBorder(), detector.rightBorder());
+        error = scanningDetector.error(encoderLeft.distance(), error, detector.leftBorder(), detector.rightBorder());
+        servo.setAngleCenter(steering.update(error));
+        estimator.update(encoderLeft, encoderRight, servo, error);
+
+        nxpcup::Buttons::Event event;
+        buttons.pollEvent(event);
+
+        if (cycle % 100 == 0) {
+            bluetooth.txLength = 0;
+            bluetooth.receive(getParameter, sizeof(getParameter));
+        }
+        sendDetectorDataLorris(channel, detector);
+        channel.poll();
+        bluetooth.transmit();
+
+        host::advance(16000);
+    }
+
+    printf("allocations: %d during initialization, %d during the run\n", initializationAllocations, allocations);
+    CHECK(allocations == 0);
+    CHECK(detector.leftBorder() > 0);
+    return test::result();
+}
@@ -0,0 +1,490 @@
+#pragma once
+
+// Host stand-in of the mbed API for the tests - only the parts used by the library.
+//
+// The time moves only by host::advance() (and wait_us()), which calls the due Ticker
+// and Timeout callbacks like the interrupts on the microcontroller. The inputs are
+// set by host::setAnalog(), host::setDigital() and host::rise().
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+enum PinName {
+    NC = -1,
+    PTA4,
+    PTA5,
+    PTA6,
+    PTA12,
+    PTA13,
+    PTA25,
+    PTA26,
+    PTA27,
+    PTB2,
+    PTB3,
+    PTB7,
+    PTB8,
+    PTB9,
+    PTB10,
+    PTB11,
+    PTB18,
+    PTC0,
+    PTC1,
+    PTC2,
+    PTC3,
+    PTC4,
+    PTC5,
+    PTC8,
+    PTC9,
+    PTC12,
+    PTC16,
+    PTD4,
+    PTD6,
+    PTD13,
+    PTE22,
+    PTE23,
+    PIN_COUNT
+};
+
+enum PinMode {
+    PullNone,
+    PullUp,
+    PullDown
+};
+
+/**
+ * Callback of function or member function without heap allocation (as mbed::Callback).
+ */
+template <typename F>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() = default;
+
+    Callback(R (*function)(Args...))
+        : m_object(nullptr)
+        , m_thunk(function ? &callFunction : nullptr)
+    {
+        memcpy(m_storage, &function, sizeof(function));
+    }
+
+    template <typename T, typename M>
+    Callback(T* object, M method)
+        : m_object(object)
+        , m_thunk(&callMethod<T, M>)
+    {
+        static_assert(sizeof(M) <= sizeof(m_storage), "member function pointer is too big");
+        memcpy(m_storage, &method, sizeof(method));
+    }
+
+    R operator()(Args... args) const { return m_thunk(m_object, m_storage, args...); }
+
+    explicit operator bool() const { return m_thunk != nullptr; }
+
+private:
+    struct Dummy {
+        void method();
+    };
+
+    static R callFunction(void*, const char* storage, Args... args)
+    {
+        R (*function)(Args...);
+        memcpy(&function, storage, sizeof(function));
+        return function(args...);
+    }
+
+    template <typename T, typename M>
+    static R callMethod(void* object, const char* storage, Args... args)
+    {
+        M method;
+        memcpy(&method, storage, sizeof(method));
+        return (static_cast<T*>(object)->*method)(args...);
+    }
+
+    void* m_object = nullptr;
+    R (*m_thunk)(void*, const char*, Args...) = nullptr;
+    char m_storage[sizeof(void (Dummy::*)())] = {};
+};
+
+template <typename T, typename M>
+Callback<void()> callback(T* object, M method)
+{
+    return Callback<void()>(object, method);
+}
+
+namespace host {
+
+class Event;
+
+struct State {
+    static constexpr int MAX_EVENTS = 32;
+    static constexpr int MAX_RISE = 4;
+
+    uint64_t nowUs = 0;
+    bool isAdvancing = false;
+    Event* events[MAX_EVENTS] = {};
+    uint16_t analog[PIN_COUNT] = {};
+    uint16_t (*analogSource[PIN_COUNT])() = {};
+    int digital[PIN_COUNT] = {};
+    Callback<void()> rise[PIN_COUNT][MAX_RISE];
+};
+
+inline State& state()
+{
+    static State instance;
+    return instance;
+}
+
+/**
+ * Periodic or one-shot callback in the simulated time (base of Ticker and Timeout).
+ */
+class Event {
+public:
+    ~Event() { detach(); }
+
+    void attach_us(Callback<void()> function, uint32_t us)
+    {
+        detach();
+        m_function = function;
+        m_intervalUs = us;
+        m_nextUs = state().nowUs + us;
+        for (Event*& event : state().events) {
+            if (!event) {
+                event = this;
+                return;
+            }
+        }
+    }
+
+    void attach(Callback<void()> function, float seconds) { attach_us(function, seconds * 1000000); }
+
+    void detach()
+    {
+        for (Event*& event : state().events) {
+            if (event == this) {
+                event = nullptr;
+            }
+        }
+    }
+
+    uint64_t nextUs() const { return m_nextUs; }
+
+    void fire()
+    {
+        if (m_isPeriodic) {
+            m_nextUs += m_intervalUs > 0 ? m_intervalUs : 1;
+        } else {
+            detach();
+        }
+        m_function();
+    }
+
+protected:
+    Event(bool isPeriodic)
+        : m_isPeriodic(isPeriodic)
+    {
+    }
+
+private:
+    const bool m_isPeriodic;
+    Callback<void()> m_function;
+    uint32_t m_intervalUs = 0;
+    uint64_t m_nextUs = 0;
+};
+
+/**
+ * Move the time forward and call the due callbacks in the order of their time.
+ *
+ * @param us time in microseconds
+ */
+inline void advance(uint64_t us)
+{
+    State& s = state();
+    uint64_t target = s.nowUs + us;
+    if (s.isAdvancing) { // wait in the callback - interrupts are blocked
+        s.nowUs = target;
+        return;
+    }
+    s.isAdvancing = true;
+    while (true) {
+        Event* next = nullptr;
+        for (Event* event : s.events) {
+            if (event && event->nextUs() <= target && (!next || event->nextUs() < next->nextUs())) {
+                next = event;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        if (next->nextUs() > s.nowUs) {
+            s.nowUs = next->nextUs();
+        }
+        next->fire();
+    }
+    if (s.nowUs < target) {
+        s.nowUs = target;
+    }
+    s.isAdvancing = false;
+}
+
+inline void setAnalog(PinName pin, uint16_t value) { state().analog[pin] = value; }
+
+/**
+ * Read the analog value from the function (e.g. camera image pixel by pixel).
+ */
+inline void setAnalogSource(PinName pin, uint16_t (*source)()) { state().analogSource[pin] = source; }
+
+inline uint16_t analog(PinName pin)
+{
+    return state().analogSource[pin] ? state().analogSource[pin]() : state().analog[pin];
+}
+
+inline void setDigital(PinName pin, int value) { state().digital[pin] = value; }
+
+/**
+ * Rising edge on the pin - calls the InterruptIn callbacks.
+ */
+inline void rise(PinName pin)
+{
+    for (const auto& function : state().rise[pin]) {
+        if (function) {
+            function();
+        }
+    }
+}
+
+} // namespace host
+
+class Ticker : public host::Event {
+public:
+    Ticker()
+        : Event(true)
+    {
+    }
+};
+
+class Timeout : public host::Event {
+public:
+    Timeout()
+        : Event(false)
+    {
+    }
+};
+
+inline uint32_t us_ticker_read() { return host::state().nowUs; }
+
+inline void wait_us(int us) { host::advance(us); }
+
+inline void wait_ms(int ms) { host::advance(uint64_t(ms) * 1000); }
+
+inline void wait(float seconds) { host::advance(seconds * 1000000); }
+
+inline void sleep() { host::advance(1); }
+
+inline void core_util_critical_section_enter() {}
+
+inline void core_util_critical_section_exit() {}
+
+class Timer {
+public:
+    void start() { m_startUs = host::state().nowUs; }
+    void stop() {}
+    void reset() { m_startUs = host::state().nowUs; }
+    int read_us() const { return host::state().nowUs - m_startUs; }
+    float read() const { return read_us() / 1000000.0f; }
+
+private:
+    uint64_t m_startUs = 0;
+};
+
+class PwmOut {
+public:
+    PwmOut(PinName pin) {}
+    void period_us(int us) { m_periodUs = us; }
+    void period(float seconds) { m_periodUs = seconds * 1000000; }
+    void pulsewidth_us(int us) { m_duty = m_periodUs ? float(us) / m_periodUs : 0; }
+    void pulsewidth(float seconds) { pulsewidth_us(seconds * 1000000); }
+    void write(float duty) { m_duty = duty; }
+    float read() const { return m_duty; }
+    int periodUs() const { return m_periodUs; }
+
+private:
+    int m_periodUs = 20000;
+    float m_duty = 0;
+};
+
+class AnalogIn {
+public:
+    AnalogIn(PinName pin)
+        : m_pin(pin)
+    {
+    }
+    uint16_t read_u16() { return host::analog(m_pin); }
+    float read() { return read_u16() / 65535.0f; }
+
+private:
+    PinName m_pin;
+};
+
+typedef struct {
+    PinName pin;
+} analogin_t;
+
+inline void analogin_init(analogin_t* object, PinName pin) { object->pin = pin; }
+
+inline uint16_t analogin_read_u16(analogin_t* object) { return host::analog(object->pin); }
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int value = 0)
+        : m_pin(pin)
+    {
+        write(value);
+    }
+    void write(int value)
+    {
+        if (m_pin != NC) {
+            host::setDigital(m_pin, value);
+        }
+    }
+    int read() const { return m_pin != NC ? host::state().digital[m_pin] : 0; }
+    DigitalOut& operator=(int value)
+    {
+        write(value);
+        return *this;
+    }
+    operator int() const { return read(); }
+
+private:
+    PinName m_pin;
+};
+
+class DigitalIn {
+public:
+    DigitalIn(PinName pin)
+        : m_pin(pin)
+    {
+    }
+    void mode(PinMode) {}
+    int read() const { return host::state().digital[m_pin]; }
+
+private:
+    PinName m_pin;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin)
+        : m_pin(pin)
+    {
+    }
+    void rise(Callback<void()> function)
+    {
+        for (auto& slot : host::state().rise[m_pin]) {
+            if (!slot) {
+                slot = function;
+                return;
+            }
+        }
+    }
+    void fall(Callback<void()>) {}
+
+private:
+    PinName m_pin;
+};
+
+/**
+ * Serial line - the transmitted bytes are stored in @{tx}, the received bytes are
+ * given by @{receive()} (calls the RX interrupt).
+ */
+class RawSerial {
+public:
+    enum IrqType {
+        RxIrq,
+        TxIrq
+    };
+
+    static constexpr int BUFFER_SIZE = 4096;
+
+    RawSerial(PinName tx, PinName rx, int baud = 9600) {}
+
+    int putc(int c)
+    {
+        if (txLength < BUFFER_SIZE) {
+            tx[txLength++] = c;
+        }
+        return c;
+    }
+
+    int getc() { return m_rxRead < m_rxLength ? m_rx[m_rxRead++] : -1; }
+
+    bool readable() const { return m_rxRead < m_rxLength; }
+
+    bool writeable() const { return true; }
+
+    int printf(const char* format, ...)
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        for (int i = 0; i < length && i < int(sizeof(buffer)) - 1; i++) {
+            putc(buffer[i]);
+        }
+        return length;
+    }
+
+    void attach(Callback<void()> function, IrqType type = RxIrq)
+    {
+        (type == RxIrq ? m_rxIrq : m_txIrq) = function;
+    }
+
+    /**
+     * Receive the bytes - calls the RX interrupt.
+     */
+    void receive(const uint8_t* data, int length)
+    {
+        if (m_rxRead == m_rxLength) {
+            m_rxRead = m_rxLength = 0;
+        }
+        for (int i = 0; i < length && m_rxLength < BUFFER_SIZE; i++) {
+            m_rx[m_rxLength++] = data[i];
+        }
+        if (m_rxIrq) {
+            m_rxIrq();
+        }
+    }
+
+    /**
+     * Empty transmit register - calls the TX interrupt while it is attached.
+     */
+    void transmit()
+    {
+        while (m_txIrq && txLength < BUFFER_SIZE) {
+            int length = txLength;
+            m_txIrq();
+            if (txLength == length) {
+                break;
+            }
+        }
+    }
+
+    uint8_t tx[BUFFER_SIZE];
+    int txLength = 0;
+
+private:
+    uint8_t m_rx[BUFFER_SIZE];
+    int m_rxLength = 0;
+    int m_rxRead = 0;
+    Callback<void()> m_rxIrq;
+    Callback<void()> m_txIrq;
+};
+
+class Serial : public RawSerial {
+public:
+    using RawSerial::RawSerial;
+};
@@ -0,0 +1,93 @@
+// The fused pipeline gives the same results as the hand-written loops over temporary
+// images; the time per frame of both is printed for comparison.
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "Camera.h"
+#include "ImagePipeline.h"
+
+#include "check.h"
+
+using namespace nxpcup;
+using Calibration = Camera::Calibration;
+using CameraImage = Camera::CameraImage;
+
+__attribute__((noinline)) size_t fused(const CameraImage& image, const Calibration& calibration)
+{
+    return pipeline::from(image).calibrate(calibration).smooth().difference().abs().threshold(500).argmax();
+}
+
+__attribute__((noinline)) size_t handWritten(const CameraImage& image, const Calibration& calibration)
+{
+    CameraImage calibrated;
+    for (int i = 0; i < 128; i++) {
+        int64_t value = int64_t(image[i]) - calibration.offset[i];
+        value = value < 0 ? 0 : (value * calibration.gain[i]) >> Calibration::GAIN_SHIFT;
+        calibrated[i] = value > UINT16_MAX ? UINT16_MAX : value;
+    }
+    CameraImage smoothed;
+    for (int i = 0; i < 128; i++) {
+        int previous = calibrated[i > 0 ? i - 1 : 0];
+        int next = calibrated[i < 127 ? i + 1 : 127];
+        smoothed[i] = (previous + 2 * calibrated[i] + next) / 4;
+    }
+    size_t best = 0;
+    int32_t maximum = 0;
+    for (int i = 0; i < 128; i++) {
+        int32_t difference = i > 0 ? int32_t(smoothed[i]) - smoothed[i - 1] : 0;
+        difference = difference < 0 ? -difference : difference;
+        if (difference < 500) {
+            difference = 0;
+        }
+        if (i == 0 || difference > maximum) {
+            maximum = difference;
+            best = i;
+        }
+    }
+    return best;
+}
+
+int main()
+{
+    constexpr int FRAMES = 20000;
+    CameraImage image;
+    Calibration calibration;
+    calibration.isValid = true;
+    long long fusedNs = 0;
+    long long handWrittenNs = 0;
+    int mismatches = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+        bool isBrightFlat = frame % 2 == 1; // gains up to UINT16_MAX on bright pixels
+        for (int i = 0; i < 128; i++) {
+            calibration.offset[i] = rand() % 200;
+            calibration.gain[i] = isBrightFlat ? 32768 + rand() % 32768 : 3500 + rand() % 1200;
+            image[i] = rand() % 65536;
+        }
+        auto start = std::chrono::steady_clock::now();
+        size_t fusedIndex = fused(image, calibration);
+        auto middle = std::chrono::steady_clock::now();
+        size_t handWrittenIndex = handWritten(image, calibration);
+        auto end = std::chrono::steady_clock::now();
+        fusedNs += (middle - start).count();
+        handWrittenNs += (end - middle).count();
+        mismatches += fusedIndex != handWrittenIndex;
+    }
+    CHECK(mismatches == 0);
+
+    CameraImage materialized;
+    pipeline::from(image).difference().abs().materialize(materialized);
+    CameraImage reference;
+    image.difference(reference);
+    CHECK(materialized.data == reference.data);
+
+    calibration.isValid = false;
+    CHECK(pipeline::from(image).calibrate(calibration).reduce(0u, [](unsigned sum, uint16_t value) { return sum + value; })
+        == pipeline::from(image).reduce(0u, [](unsigned sum, uint16_t value) { return sum + value; }));
+
+    printf("fused %lld ns/frame, hand-written %lld ns/frame\n", fusedNs / FRAMES, handWrittenNs / FRAMES);
+    return test::result();
+}
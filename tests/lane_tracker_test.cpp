@@ -0,0 +1,111 @@
+// The tracker reports one of the lane hypotheses (not the mean between two of them)
+// and follows a moving lane with glare and dropouts; the time per frame is printed.
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "LaneTracker.h"
+
+#include "check.h"
+
+using nxpcup::LaneTracker;
+using ImageData = std::array<LaneTracker::ImageType, LaneTracker::Config::dataSize>;
+
+static void addEdge(ImageData& data, int position, int value)
+{
+    if (position >= 0 && position < LaneTracker::Config::dataSize) {
+        data[position] = value;
+    }
+}
+
+/**
+ * Two lanes of the same width are visible (e.g. the lane and a second line next to it),
+ * the hypotheses are spread over the whole image before every trial.
+ */
+static void twoHypotheses()
+{
+    ImageData data;
+    for (auto& pixel : data) {
+        pixel = rand() % 300;
+    }
+    addEdge(data, 10, 16000);
+    addEdge(data, 100, 16000);
+    addEdge(data, 30, 16000);
+    addEdge(data, 120, 16000);
+
+    LaneTracker::Config config;
+    config.minimalWidth = 80; // only 10 <-> 100 and 30 <-> 120 are lanes
+    config.maximalWidth = 100;
+    LaneTracker tracker(config);
+    int betweenCount = 0;
+    for (int trial = 0; trial < 1000; trial++) {
+        tracker.reset();
+        for (int frame = 0; frame < 5; frame++) {
+            tracker.update(data);
+            // both borders away from the edges - the mean of the lanes
+            constexpr int N = LaneTracker::Config::NEIGHBORHOOD;
+            int left = tracker.leftBorder();
+            int right = tracker.rightBorder();
+            betweenCount += left > 10 + N && left < 30 - N && right > 100 + N && right < 120 - N;
+        }
+    }
+    printf("two hypotheses: %d of 5000 estimates between them\n", betweenCount);
+    // only the random hypotheses before any of them reaches the edges (the mean of all hypotheses: about 13 %)
+    CHECK(betweenCount < 50);
+}
+
+/**
+ * Lane moving left and right, glare next to the lane and frames without one border.
+ */
+static void movingLane()
+{
+    ImageData data;
+    LaneTracker tracker({});
+    long long nanoseconds = 0;
+    long long errorSum = 0;
+    int measured = 0;
+    int position = 20;
+    int direction = 1;
+    constexpr int FRAMES = 20000;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        if (frame % 4 == 0) {
+            position += direction;
+            if (position <= 5 || position >= 35) {
+                direction = -direction;
+            }
+        }
+        for (auto& pixel : data) {
+            pixel = rand() % 2000;
+        }
+        if (rand() % 10 != 0) {
+            addEdge(data, position, 12000 + rand() % 8000);
+        }
+        if (rand() % 10 != 0) {
+            addEdge(data, position + 88, 12000 + rand() % 8000);
+        }
+        if (rand() % 20 == 0) { // glare
+            addEdge(data, rand() % 128, 30000);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        tracker.update(data);
+        nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        if (frame >= 100) {
+            errorSum += nxpcup::abs(tracker.leftBorder() - position) + nxpcup::abs(tracker.rightBorder() - position - 88);
+            measured++;
+        }
+    }
+    double meanError = double(errorSum) / (2 * measured);
+    printf("moving lane: mean error %.2f px, %lld ns/frame\n", meanError, nanoseconds / FRAMES);
+    CHECK(meanError < 2.0);
+}
+
+int main()
+{
+    twoHypotheses();
+    movingLane();
+    return test::result();
+}
@@ -0,0 +1,18 @@
+// MemoryFootprint.h compiles on its own (included first) and the tables are printed.
+
+#include "MemoryFootprint.h"
+
+#include "check.h"
+
+int main()
+{
+    for (const auto& entry : nxpcup::footprint::CLASSES) {
+        printf("%s: %u\n", entry.name, static_cast<unsigned>(entry.size));
+        CHECK(entry.size > 0);
+    }
+    for (const auto& entry : nxpcup::footprint::FEATURES) {
+        printf("%s: %u\n", entry.name, static_cast<unsigned>(entry.size));
+    }
+    printf("representative: %u\n", static_cast<unsigned>(nxpcup::footprint::REPRESENTATIVE));
+    return test::result();
+}
@@ -0,0 +1,103 @@
+// Detection of the obstacle by the sensor on the servo at several speeds, the sweep over
+// the whole range against the adaptive scanning: the distance left to the obstacle
+// when the detector is triggered is printed, the adaptive scanning detects it earlier.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "mbed.h"
+
+#include "ObstacleDetectorWithServo.h"
+
+#include "check.h"
+
+using nxpcup::ObstacleDetectorWithServo;
+
+constexpr PinName SENSOR = PTB7;
+constexpr float SENSOR_RANGE = 0.8; // meters
+constexpr float OBSTACLE_HALF_WIDTH = 0.05;
+constexpr float BEAM_HALF_ANGLE = 3; // degree
+constexpr int LEFT_BORDER = 20; // lane seen by camera in pixels
+constexpr int RIGHT_BORDER = 108;
+
+// obstacle position from the sensor (forward and right in meters)
+static float obstacleAhead = 0;
+static float obstacleRight = 0;
+static const ObstacleDetectorWithServo* detector = nullptr;
+
+/**
+ * Optical sensor - value inversely proportional to the distance of the obstacle in the beam.
+ */
+static uint16_t sensorSource()
+{
+    float distance = hypotf(obstacleAhead, obstacleRight);
+    float bearing = atan2f(obstacleRight, obstacleAhead) * float(180 / M_PI);
+    float halfAngle = atanf(OBSTACLE_HALF_WIDTH / std::max(distance, 0.01f)) * float(180 / M_PI) + BEAM_HALF_ANGLE;
+    float beam = detector->servoPositionDegree() - 90;
+    int noise = rand() % 1000;
+    if (obstacleAhead > 0 && distance < SENSOR_RANGE && fabsf(beam - bearing) < halfAngle) {
+        return std::min(65535.0f, 12000 / distance + noise);
+    }
+    return 2000 + noise;
+}
+
+/**
+ * Drive straight to the obstacle in the lane.
+ *
+ * @param right lateral position of the obstacle in meters (positive = right)
+ * @return distance to the obstacle when triggered (negative = passed without detection)
+ */
+static float detectionDistance(ObstacleDetectorWithServo::ScanMode scanMode, float speed, float right)
+{
+    ObstacleDetectorWithServo::Config config { SENSOR, { PTA13, 0, 60 }, 20000, 15, 0.8 };
+    config.scanMode = scanMode;
+    ObstacleDetectorWithServo scanning(config);
+    detector = &scanning;
+
+    constexpr int PERIOD_US = 5000;
+    obstacleAhead = 2.5;
+    obstacleRight = right;
+    float distance = 0;
+    while (obstacleAhead > -0.1f) {
+        host::advance(PERIOD_US);
+        float move = speed * PERIOD_US / 1000000;
+        distance += move;
+        obstacleAhead -= move;
+        scanning.error(distance, 0, LEFT_BORDER, RIGHT_BORDER);
+        if (scanning.avoidingObstacle() != ObstacleDetectorWithServo::AvoidingObstacle::no) {
+            break;
+        }
+    }
+    detector = nullptr;
+    return obstacleAhead;
+}
+
+int main()
+{
+    host::setAnalogSource(SENSOR, sensorSource);
+    constexpr int TRIALS = 20;
+    for (float speed : { 1.0f, 2.0f, 3.0f }) {
+        float sum[2] = {};
+        int missed[2] = {};
+        for (int trial = 0; trial < TRIALS; trial++) {
+            float right = (trial % 7 - 3) * 0.05f; // across the lane
+            for (int mode = 0; mode < 2; mode++) {
+                float left = detectionDistance(mode == 0 ? ObstacleDetectorWithServo::ScanMode::sweep
+                                                         : ObstacleDetectorWithServo::ScanMode::adaptive,
+                    speed, right);
+                if (left < 0) {
+                    missed[mode]++;
+                } else {
+                    sum[mode] += left;
+                }
+            }
+        }
+        float sweep = sum[0] / std::max(TRIALS - missed[0], 1);
+        float adaptive = sum[1] / std::max(TRIALS - missed[1], 1);
+        printf("%.1f m/s: obstacle detected %.2f m (%.0f ms) -> %.2f m (%.0f ms) ahead, missed %d -> %d of %d\n",
+            speed, sweep, 1000 * sweep / speed, adaptive, 1000 * adaptive / speed, missed[0], missed[1], TRIALS);
+        CHECK(missed[1] <= missed[0]);
+        CHECK(adaptive > sweep);
+    }
+    return test::result();
+}
@@ -0,0 +1,154 @@
+// Save and load cycles of the parameters over the sector switches, with damaged records
+// and interrupted writes, on backends with different sector and program sizes.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mbed.h"
+
+#include "ParameterStore.h"
+
+#include "check.h"
+
+using namespace nxpcup;
+
+/**
+ * Flash in the memory - checks the alignment of the programming and that only erased bytes are programmed.
+ */
+class MemoryBackend : public StorageBackend {
+public:
+    MemoryBackend(uint32_t sectorSize, uint32_t programSize)
+        : m_sectorSize(sectorSize)
+        , m_programSize(programSize)
+    {
+        memset(m_data, 0xFF, sizeof(m_data));
+    }
+
+    uint32_t sectorSize() const override { return m_sectorSize; }
+
+    uint32_t programSize() const override { return m_programSize; }
+
+    bool read(int sector, uint32_t offset, void* data, uint32_t size) override
+    {
+        memcpy(data, m_data + sector * m_sectorSize + offset, size);
+        return true;
+    }
+
+    bool erase(int sector) override
+    {
+        memset(m_data + sector * m_sectorSize, 0xFF, m_sectorSize);
+        erases++;
+        return true;
+    }
+
+    bool program(int sector, uint32_t offset, const void* data, uint32_t size) override
+    {
+        if (offset % m_programSize != 0 || size % m_programSize != 0 || offset + size > m_sectorSize) {
+            misaligned++;
+            return false;
+        }
+        if (failAfter == 0) { // power loss - the rest of the record is not written
+            return false;
+        }
+        failAfter--;
+        uint8_t* target = m_data + sector * m_sectorSize + offset;
+        for (uint32_t i = 0; i < size; i++) {
+            if (target[i] != 0xFF) {
+                overwritten++;
+            }
+        }
+        memcpy(target, data, size);
+        return true;
+    }
+
+    /**
+     * Flip one bit of the parameters in the newest record.
+     */
+    void damage(uint32_t sequence)
+    {
+        for (uint32_t offset = 0; offset + 16 < sizeof(m_data); offset += 4) {
+            uint32_t magic, recordSequence;
+            memcpy(&magic, m_data + offset, 4);
+            memcpy(&recordSequence, m_data + offset + 8, 4);
+            if (magic == 0x4E585043 && recordSequence == sequence) {
+                m_data[offset + 20] ^= 1;
+                return;
+            }
+        }
+    }
+
+    int erases = 0;
+    int misaligned = 0;
+    int overwritten = 0;
+    int failAfter = -1;
+
+private:
+    uint8_t m_data[2 * 8192];
+    uint32_t m_sectorSize;
+    uint32_t m_programSize;
+};
+
+struct Parameters {
+    uint32_t counter;
+    float values[150];
+};
+
+static void fill(Parameters& parameters, uint32_t counter)
+{
+    parameters.counter = counter;
+    for (auto& value : parameters.values) {
+        value = counter * 0.5f;
+    }
+}
+
+/**
+ * 200 cycles of save and load by new store (as after the restart) with damaged records and power losses.
+ */
+static void cycles(uint32_t sectorSize, uint32_t programSize)
+{
+    MemoryBackend backend(sectorSize, programSize);
+    uint32_t expected = 0;
+    int failures = 0;
+    for (uint32_t cycle = 1; cycle <= 200; cycle++) {
+        ParameterStore<Parameters> store(backend, 1);
+        Parameters parameters = {};
+        bool isLoaded = store.load(parameters);
+        if (expected != 0 && (!isLoaded || parameters.counter != expected || parameters.values[149] != expected * 0.5f)) {
+            failures++;
+        }
+
+        fill(parameters, cycle);
+        if (cycle % 17 == 0) { // power loss after the first unit of the record
+            backend.failAfter = 1;
+            store.save(parameters);
+            backend.failAfter = -1;
+            continue;
+        }
+        if (!store.save(parameters)) {
+            failures++;
+            continue;
+        }
+        if (cycle % 23 == 0) { // damaged record - the previous one is loaded
+            backend.damage(store.sequence());
+            continue;
+        }
+        expected = cycle;
+    }
+    printf("sector %u B, program %u B: %d erases\n", sectorSize, programSize, backend.erases);
+    CHECK(failures == 0);
+    CHECK(backend.misaligned == 0);
+    CHECK(backend.overwritten == 0);
+
+    ParameterStore<Parameters> otherVersion(backend, 2);
+    Parameters parameters;
+    CHECK(!otherVersion.load(parameters));
+}
+
+int main()
+{
+    cycles(1024, 4); // KL25Z - one record in the sector
+    cycles(4096, 8); // K66F
+    cycles(4096, 128);
+    cycles(8192, 256);
+    return test::result();
+}
@@ -0,0 +1,65 @@
+// The filtered lane error is closer to the true one than the raw error from camera
+// (noise of the camera, glitches and noisy encoders) in a closed loop simulation of the car
+// driving through alternating curves; the RMS errors are printed.
+
+#include <math.h>
+#include <random>
+
+#include "mbed.h"
+
+#include "StateEstimator.h"
+
+#include "check.h"
+
+using namespace nxpcup;
+
+int main()
+{
+    static FakeClock clock;
+    setSystemClock(clock);
+    StateEstimator::Config config;
+    StateEstimator estimator(config);
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0, 1);
+
+    constexpr float SPEED = 1.5;
+    constexpr float DT = 0.01;
+    float offset = 0.02;
+    float heading = 0.05;
+    double rawSquares = 0;
+    double filteredSquares = 0;
+    int measured = 0;
+    for (int cycle = 0; cycle < 2000; cycle++) {
+        // regulator from the true state with a small excitation
+        float steering = -60 * (offset + config.lookAhead * heading) * 57.3f / 10 + 3 * sinf(cycle * 0.02f);
+        steering = clamp(steering, -25.0f, 25.0f);
+        float yawRate = SPEED * tanf(steering * float(M_PI / 180)) / config.wheelBase;
+        float curvature = cycle % 600 < 300 ? 0.8f : -0.5f;
+
+        clock.advance(DT * 1000000);
+        offset += SPEED * heading * DT;
+        heading += (yawRate - SPEED * curvature) * DT;
+
+        float leftSpeed = SPEED + yawRate * config.trackWidth / 2 + 0.05f * noise(generator);
+        float rightSpeed = SPEED - yawRate * config.trackWidth / 2 + 0.05f * noise(generator);
+        float seenOffset = offset + config.lookAhead * heading;
+        int error = int(-(seenOffset + 0.01f * noise(generator)) * config.pixelsPerMeter);
+        if (cycle % 97 == 0) { // glitch
+            error += 40;
+        }
+        estimator.update(leftSpeed, rightSpeed, steering, error);
+
+        float trueError = -seenOffset * config.pixelsPerMeter;
+        if (cycle > 200) {
+            rawSquares += (error - trueError) * (error - trueError);
+            filteredSquares += (estimator.laneError() - trueError) * (estimator.laneError() - trueError);
+            measured++;
+        }
+    }
+    float rawRms = sqrt(rawSquares / measured);
+    float filteredRms = sqrt(filteredSquares / measured);
+    printf("lane error RMS: raw %.2f px, filtered %.2f px\n", rawRms, filteredRms);
+    CHECK(filteredRms < rawRms * 0.6f);
+    CHECK(fabsf(estimator.state().speed - SPEED) < 0.1f);
+    return test::result();
+}
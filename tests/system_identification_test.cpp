@@ -0,0 +1,184 @@
+// The gains suggested from the identified model are the SIMC gains in the units of the regulators,
+// the steering (integrating process) is fitted by the integrator with dead time and regulated
+// with the predictor of the integrating model, a spike in the step response doesn't break the fit.
+
+#include <math.h>
+#include <random>
+
+#include "mbed.h"
+
+#include "SteeringControl.h"
+#include "SystemIdentification.h"
+
+#include "check.h"
+
+using namespace nxpcup;
+
+static bool isClose(float value, float expected)
+{
+    return fabsf(value - expected) <= 1e-4f * fabsf(expected);
+}
+
+/**
+ * SIMC for the first-order model with dead time: Kc = tau / (k * (tauC + theta)),
+ * tauI = min(tau, 4 * (tauC + theta)), tauC = theta. MotorControl integrates coefficientI
+ * per @{MotorControl::Config::periodUs}, so coefficientI = Kc * period / tauI.
+ */
+static void motorGains()
+{
+    Motor motor(Motor::Config { PTA4, PTA5 });
+    Encoder encoder(Encoder::Config { PTD4 });
+    MotorIdentification identification(motor, encoder, {});
+
+    PlantModel model;
+    model.gain = 0.002; // m/s per motor power unit
+    model.timeConstant = 0.15;
+    model.deadTime = 0.02;
+    model.isValid = true;
+
+    for (uint32_t periodUs : { 5000u, 10000u, 20000u }) {
+        MotorControl::Config base;
+        base.periodUs = periodUs;
+        MotorControl::Config suggested = identification.suggestConfig(model, base);
+
+        float gain = model.gain * motor.maxPower();
+        float closedLoop = model.deadTime;
+        float proportional = model.timeConstant / (gain * (closedLoop + model.deadTime));
+        float integralTime = std::min(model.timeConstant, 4 * (closedLoop + model.deadTime));
+        printf("period %u us: P %.4f (expected %.4f), I %.6f (expected %.6f)\n", static_cast<unsigned>(periodUs),
+            suggested.coefficientP, proportional, suggested.coefficientI, proportional * periodUs / 1e6f / integralTime);
+        CHECK(isClose(suggested.coefficientP, proportional));
+        // integral action per second is Kc / tauI for any period of the regulator
+        CHECK(isClose(suggested.coefficientI / (periodUs / 1e6f), proportional / integralTime));
+        CHECK(suggested.periodUs == periodUs);
+    }
+}
+
+/**
+ * Identification fed by the simulation.
+ */
+class Recorder : public SystemIdentification {
+public:
+    Recorder(int amplitude)
+        : SystemIdentification(Config { Excitation::step, amplitude })
+    {
+    }
+
+    using SystemIdentification::record;
+};
+
+constexpr uint32_t PERIOD_US = 5000;
+
+/**
+ * Lane error of the car steered by the step of the servo: integrator with dead time,
+ * quantized to pixels with noise.
+ */
+static void integratorFit(FakeClock& clock)
+{
+    constexpr float RATE = 15; // pixels per degree and second
+    constexpr int DEAD_SAMPLES = 6;
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0, 0.5);
+    Recorder recorder(SteeringIdentification::DEFAULT_AMPLITUDE);
+    recorder.start();
+    float error = 0;
+    for (int k = 0; k < SystemIdentification::MAX_SAMPLES; k++) {
+        int input = recorder.excitation(k);
+        recorder.record(input, roundf(error + noise(generator)));
+        error += RATE * recorder.excitation(std::max(k - DEAD_SAMPLES, 0)) * PERIOD_US / 1e6f;
+        clock.advance(PERIOD_US);
+    }
+    PlantModel model = recorder.fitIntegrating();
+    printf("integrator: rate %.2f px/(deg s) (simulated %.2f), dead time %.3f s (simulated %.3f)\n",
+        model.gain, RATE, model.deadTime, DEAD_SAMPLES * PERIOD_US / 1e6f);
+    CHECK(model.isValid && model.isIntegrating);
+    CHECK(fabsf(model.gain - RATE) < 0.05f * RATE);
+    // the noise hides the first samples of the slow drift
+    CHECK(fabsf(model.deadTime - DEAD_SAMPLES * PERIOD_US / 1e6f) <= 2 * PERIOD_US / 1e6f);
+}
+
+/**
+ * First-order step response with one spike over the double of the steady value.
+ */
+static void spikeInStep(FakeClock& clock)
+{
+    Recorder recorder(100);
+    recorder.start();
+    float output = 0;
+    for (int k = 0; k < SystemIdentification::MAX_SAMPLES; k++) {
+        int input = recorder.excitation(k);
+        output += 0.05f * (2 * input - output);
+        bool isSpike = k == SystemIdentification::STEP_START + 100;
+        recorder.record(input, isSpike ? 2.5f * output : output);
+        clock.advance(PERIOD_US);
+    }
+    PlantModel model = recorder.fitSecondOrder();
+    printf("spike: damping ratio %.2f, natural frequency %.2f rad/s\n", model.dampingRatio, model.naturalFrequency);
+    CHECK(model.isValid);
+    CHECK(model.dampingRatio > 0 && model.dampingRatio <= 1);
+    CHECK(std::isfinite(model.naturalFrequency) && model.naturalFrequency > 0);
+}
+
+/**
+ * SIMC for the integrator with dead time: Kc = 1 / (k * (tauC + theta)), tauI = 4 * (tauC + theta).
+ * The suggested regulator with the predictor of the integrating model steers the simulated car
+ * to the lane center (also with the constant disturbance - the model output is rebased).
+ */
+static void steeringGains(FakeClock& clock)
+{
+    Servo servo(Servo::Config { PTA12, 0, 45 });
+    BorderDetector detector({});
+    SteeringIdentification identification(servo, detector, {});
+    PlantModel model;
+    model.gain = 15;
+    model.deadTime = 0.03;
+    model.isIntegrating = true;
+    model.isValid = true;
+    atoms::Pid<float>::Config pid = identification.suggestConfig(model, { 0, 0, 0, -30, 30 });
+    float closedLoop = model.deadTime;
+    float proportional = 1 / (model.gain * (closedLoop + model.deadTime));
+    printf("steering: P %.4f (expected %.4f), I %.6f (expected %.6f), D %.4f\n", pid.p, proportional,
+        pid.i, proportional * PERIOD_US / 1e6f / (4 * (closedLoop + model.deadTime)), pid.d);
+    CHECK(isClose(pid.p, proportional));
+    CHECK(isClose(pid.i, proportional * PERIOD_US / 1e6f / (4 * (closedLoop + model.deadTime))));
+    CHECK(pid.d == 0);
+
+    SteeringControl::Config config;
+    config.pid = pid;
+    SteeringControl steering(config);
+    steering.setModel(model);
+    CHECK(steering.config().modelTimeConstant == 0);
+
+    constexpr int DEAD_SAMPLES = 6;
+    std::array<float, DEAD_SAMPLES + 1> commands = {};
+    float error = 20;
+    float peak = 0;
+    int samples = 60 * 1000000 / PERIOD_US;
+    for (int k = 0; k < samples; k++) {
+        clock.advance(PERIOD_US);
+        float angle = steering.update(error);
+        for (int i = DEAD_SAMPLES; i > 0; i--) {
+            commands[i] = commands[i - 1];
+        }
+        commands[0] = angle;
+        float disturbance = 20; // pixels per second (e.g. curve) - the model output is rebased
+        error += (model.gain * commands[DEAD_SAMPLES] + disturbance) * PERIOD_US / 1e6f;
+        if (k > 200) {
+            peak = std::max(peak, fabsf(error));
+        }
+    }
+    printf("steering loop: error %.3f px after 60 s, peak %.3f px after 1 s\n", error, peak);
+    CHECK(fabsf(error) < 0.5f);
+    CHECK(peak < 5);
+}
+
+int main()
+{
+    static FakeClock clock;
+    setSystemClock(clock);
+    motorGains();
+    integratorFit(clock);
+    spikeInStep(clock);
+    steeringGains(clock);
+    return test::result();
+}
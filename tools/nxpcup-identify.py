@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Host fitter of the identification records (src/SystemIdentification.h).
+
+The car sends the record by sendIdentificationDataLorris() (packets 0x80 0x0A, length 6:
+index, input, output as big-endian int16). The tool fits the same models as the car
+(first order + dead time, integrator + dead time) over the whole record and prints
+the suggested gains - use it to check the on-car fit or with a longer dead time.
+
+    nxpcup-identify.py capture.bin --period 0.005
+    nxpcup-identify.py record.csv --period 0.01 --offset 0 --scale 1
+    nxpcup-identify.py /dev/rfcomm0 --serial --duration 5 --save capture.bin
+
+CSV lines are "index,input,output". Reading the serial port requires pyserial.
+"""
+
+import argparse
+import math
+import struct
+import sys
+import time
+
+HEADER = 0x80
+IDENTIFICATION_SAMPLE = 0x0A
+SAMPLE_LENGTH = 6
+
+
+def parse_packets(data):
+    """Return the samples {index: (input, output)} found in the raw stream."""
+    samples = {}
+    position = 0
+    while True:
+        position = data.find(bytes([HEADER, IDENTIFICATION_SAMPLE, SAMPLE_LENGTH]), position)
+        if position < 0 or position + 3 + SAMPLE_LENGTH > len(data):
+            return samples
+        index, value_in, value_out = struct.unpack(">hhh", data[position + 3 : position + 3 + SAMPLE_LENGTH])
+        samples[index] = (value_in, value_out)
+        position += 3 + SAMPLE_LENGTH
+
+
+def parse_csv(text):
+    samples = {}
+    for line in text.splitlines():
+        fields = [field.strip() for field in line.split(",")]
+        if len(fields) < 3 or not fields[0].lstrip("-").isdigit():
+            continue  # header or empty line
+        samples[int(fields[0])] = (int(fields[1]), int(fields[2]))
+    return samples
+
+
+def read_serial(port, baudrate, duration):
+    import serial  # pyserial
+
+    link = serial.Serial(port, baudrate, timeout=0.05)
+    data = bytearray()
+    deadline = time.monotonic() + duration
+    while time.monotonic() < deadline:
+        data += link.read(4096)
+    return bytes(data)
+
+
+def ordered(samples):
+    """Return the inputs and outputs of the continuous record starting at index 0."""
+    inputs, outputs = [], []
+    index = 0
+    while index in samples:
+        inputs.append(samples[index][0])
+        outputs.append(samples[index][1])
+        index += 1
+    return inputs, outputs
+
+
+def fit_first_order(inputs, outputs, offset, baseline, max_dead_time):
+    """y[k+1] = a y[k] + b u[k-d] - least squares for every d, the smallest residual wins."""
+    best = None
+    for d in range(max_dead_time + 1):
+        syy = syu = suu = ry = ru = stt = 0.0
+        for k in range(max_dead_time, len(outputs) - 1):
+            y = outputs[k] - baseline
+            u = inputs[k - d] - offset
+            following = outputs[k + 1] - baseline
+            syy += y * y
+            syu += y * u
+            suu += u * u
+            ry += y * following
+            ru += u * following
+            stt += following * following
+        determinant = syy * suu - syu * syu
+        if determinant == 0:
+            continue
+        a = (ry * suu - ru * syu) / determinant
+        b = (ru * syy - ry * syu) / determinant
+        residual = stt - a * ry - b * ru
+        if 0 < a < 1 and (best is None or residual < best[0]):
+            best = (residual, a, b, d)
+    return best
+
+
+def fit_integrating(inputs, outputs, offset, max_dead_time):
+    """y[k+1] - y[k] = b u[k-d] - least squares for every d, the smallest residual wins."""
+    best = None
+    for d in range(max_dead_time + 1):
+        suu = ru = stt = 0.0
+        for k in range(max_dead_time, len(outputs) - 1):
+            u = inputs[k - d] - offset
+            change = outputs[k + 1] - outputs[k]
+            suu += u * u
+            ru += u * change
+            stt += change * change
+        if suu == 0:
+            continue
+        b = ru / suu
+        residual = stt - b * ru
+        if b != 0 and (best is None or residual < best[0]):
+            best = (residual, b, d)
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Fit the plant model from the identification record.")
+    parser.add_argument("source", help="capture of the serial line, CSV file or serial port (with --serial)")
+    parser.add_argument("--period", type=float, required=True, help="sample period in seconds (Config::samplePeriodUs)")
+    parser.add_argument("--offset", type=int, default=0, help="operating point of the excitation (Config::offset)")
+    parser.add_argument("--scale", type=float, default=1.0, help="multiplier of the recorded output (Config::outputScale)")
+    parser.add_argument("--max-dead-time", type=int, default=10, help="longest dead time in samples")
+    parser.add_argument("--serial", action="store_true", help="read the record from the serial port")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--duration", type=float, default=5.0, help="time of reading the serial port in seconds")
+    parser.add_argument("--save", help="write the received bytes into a file")
+    args = parser.parse_args()
+
+    if args.serial:
+        data = read_serial(args.source, args.baudrate, args.duration)
+        if args.save:
+            with open(args.save, "wb") as capture:
+                capture.write(data)
+        samples = parse_packets(data)
+    else:
+        with open(args.source, "rb") as source:
+            data = source.read()
+        samples = parse_packets(data) if bytes([HEADER, IDENTIFICATION_SAMPLE]) in data else parse_csv(data.decode(errors="replace"))
+
+    inputs, outputs = ordered(samples)
+    if len(outputs) < 2 * args.max_dead_time:
+        sys.exit("error: %d continuous samples, at least %d needed" % (len(outputs), 2 * args.max_dead_time))
+    print("%d samples, %.3f s" % (len(outputs), len(outputs) * args.period))
+
+    # baseline before the step (first sample for the chirp)
+    start = next((k for k, value in enumerate(inputs) if value != args.offset), 1) or 1
+    baseline = sum(outputs[:start]) / start
+    first_order = fit_first_order(inputs, outputs, args.offset, baseline, args.max_dead_time)
+    integrating = fit_integrating(inputs, outputs, args.offset, args.max_dead_time)
+
+    if first_order:
+        residual, a, b, d = first_order
+        gain = b / ((1 - a) * args.scale)
+        time_constant = -args.period / math.log(a)
+        dead_time = d * args.period
+        closed_loop = dead_time if dead_time > args.period else time_constant / 2
+        proportional = time_constant / (gain * (closed_loop + dead_time))
+        integral_time = min(time_constant, 4 * (closed_loop + dead_time))
+        print("first order:  gain %.4f, time constant %.4f s, dead time %.4f s, residual %.1f"
+              % (gain, time_constant, dead_time, residual))
+        print("  PID per sample: p %.4f, i %.6f, d %.4f"
+              % (proportional, proportional * args.period / integral_time, proportional * dead_time / 2 / args.period))
+    else:
+        print("first order:  no stable fit")
+
+    if integrating:
+        residual, b, d = integrating
+        gain = b / (args.period * args.scale)
+        dead_time = d * args.period
+        closed_loop = max(dead_time, 4 * args.period)
+        proportional = 1 / (gain * (closed_loop + dead_time))
+        print("integrating:  gain %.4f per second, dead time %.4f s, residual %.1f" % (gain, dead_time, residual))
+        print("  PI per sample: p %.4f, i %.6f" % (proportional, proportional * args.period / (4 * (closed_loop + dead_time))))
+    else:
+        print("integrating:  no fit")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""Host tool for the live tuning of the car over the serial line (src/CommandChannel.h).
+
+    nxpcup-tune.py /dev/rfcomm0 list
+    nxpcup-tune.py /dev/rfcomm0 get motor.p
+    nxpcup-tune.py /dev/rfcomm0 set motor.p 0.8 motor.i 0.1
+    nxpcup-tune.py /dev/rfcomm0 shell
+
+Requires pyserial (pip install pyserial).
+"""
+
+import argparse
+import shlex
+import struct
+import sys
+import time
+
+HEADER = 0x80
+SET_PARAMETER = 0x20
+GET_PARAMETER = 0x21
+PARAMETER_VALUE = 0x22
+LIST_PARAMETERS = 0x23
+PARAMETER_INFO = 0x24
+ERROR_REPLY = 0x2F
+REPLIES = (PARAMETER_VALUE, PARAMETER_INFO, ERROR_REPLY)
+LOGGING = range(0x01, 0x0B)  # packets from Log.h - without CRC
+
+TYPES = ["bool", "int8", "uint8", "int16", "uint16", "int32", "uint32", "float"]
+ERRORS = {1: "unknown command", 2: "unknown parameter", 3: "bad length"}
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode(type_name, text):
+    if type_name == "float":
+        return struct.pack("<f", float(text))
+    if type_name == "bool":
+        value = 1 if text.lower() in ("1", "true", "on", "yes") else 0
+    else:
+        value = int(text, 0)
+    return struct.pack(">I", value & 0xFFFFFFFF)
+
+
+def decode(type_name, data):
+    if type_name == "float":
+        return struct.unpack("<f", data)[0]
+    value = struct.unpack(">i", data)[0]
+    if type_name == "bool":
+        return bool(value)
+    if type_name == "uint32":
+        return value & 0xFFFFFFFF
+    return value
+
+
+class Channel:
+    def __init__(self, port, baudrate, timeout):
+        import serial  # pyserial
+
+        self.serial = serial.Serial(port, baudrate, timeout=0.05)
+        self.buffer = bytearray()
+        self.timeout = timeout
+        self.parameters = {}  # name -> (id, type)
+
+    def send(self, command, data=b""):
+        body = bytes([command, len(data)]) + bytes(data)
+        self.serial.write(bytes([HEADER]) + body + bytes([crc8(body)]))
+
+    def fill(self, size, deadline):
+        while len(self.buffer) < size:
+            if time.monotonic() > deadline:
+                raise TimeoutError("no reply from the car")
+            self.buffer += self.serial.read(max(size - len(self.buffer), 1))
+
+    def receive(self):
+        """Return the next reply (command, data) - the logging packets are skipped."""
+        deadline = time.monotonic() + self.timeout
+        while True:
+            start = self.buffer.find(bytes([HEADER]))
+            if start < 0:
+                self.buffer.clear()
+                self.fill(1, deadline)
+                continue
+            del self.buffer[:start]
+            self.fill(3, deadline)
+            command, length = self.buffer[1], self.buffer[2]
+            if command in REPLIES:
+                self.fill(length + 4, deadline)
+                packet = bytes(self.buffer[: length + 4])
+                if packet[-1] == crc8(packet[1:-1]):
+                    del self.buffer[: length + 4]
+                    data = packet[3:-1]
+                    if command == ERROR_REPLY:
+                        raise RuntimeError(ERRORS.get(data[0], "error %d" % data[0]))
+                    return command, data
+            elif command in LOGGING:
+                self.fill(length + 3, deadline)
+                del self.buffer[: length + 3]
+                continue
+            del self.buffer[:1]  # not a packet - search the next header
+
+    def list(self):
+        self.send(LIST_PARAMETERS)
+        self.parameters = {}
+        try:
+            while True:
+                command, data = self.receive()
+                if command == PARAMETER_INFO:
+                    self.parameters[data[2:].decode(errors="replace")] = (data[0], TYPES[data[1]])
+        except TimeoutError:
+            pass
+        return self.parameters
+
+    def lookup(self, name):
+        if not self.parameters:
+            self.list()
+        if name not in self.parameters:
+            raise KeyError("unknown parameter %s" % name)
+        return self.parameters[name]
+
+    def value(self, expected_id):
+        while True:
+            command, data = self.receive()
+            if command == PARAMETER_VALUE and data[0] == expected_id:
+                return decode(TYPES[data[1]], data[2:6])
+
+    def get(self, name):
+        parameter_id, _ = self.lookup(name)
+        self.send(GET_PARAMETER, bytes([parameter_id]))
+        return self.value(parameter_id)
+
+    def set(self, name, text):
+        parameter_id, type_name = self.lookup(name)
+        self.send(SET_PARAMETER, bytes([parameter_id]) + encode(type_name, text))
+        return self.value(parameter_id)
+
+
+def run(channel, command, arguments):
+    if command == "list":
+        for name, (parameter_id, type_name) in sorted(channel.list().items(), key=lambda item: item[1][0]):
+            print("%3d %-7s %s" % (parameter_id, type_name, name))
+    elif command == "get":
+        for name in arguments:
+            print("%s = %s" % (name, channel.get(name)))
+    elif command == "set":
+        if len(arguments) % 2 != 0:
+            raise ValueError("set needs pairs of name and value")
+        for name, text in zip(arguments[::2], arguments[1::2]):
+            print("%s = %s" % (name, channel.set(name, text)))
+    else:
+        raise ValueError("unknown command %s (list, get, set, shell)" % command)
+
+
+def shell(channel):
+    print("commands: list, get NAME..., set NAME VALUE..., quit")
+    while True:
+        try:
+            line = input("> ")
+        except EOFError:
+            return
+        words = shlex.split(line)
+        if not words:
+            continue
+        if words[0] in ("quit", "exit"):
+            return
+        try:
+            run(channel, words[0], words[1:])
+        except (KeyError, ValueError, RuntimeError, TimeoutError) as error:
+            print("error: %s" % error)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Live tuning of the car parameters over the serial line.")
+    parser.add_argument("port", help="serial port of the Bluetooth link (e.g. /dev/rfcomm0, COM5)")
+    parser.add_argument("command", choices=["list", "get", "set", "shell"])
+    parser.add_argument("arguments", nargs="*", help="parameter names (and values for set)")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=1.0, help="time for the reply in seconds")
+    args = parser.parse_args()
+
+    channel = Channel(args.port, args.baudrate, args.timeout)
+    try:
+        if args.command == "shell":
+            shell(channel)
+        else:
+            run(channel, args.command, args.arguments)
+    except (KeyError, ValueError, RuntimeError, TimeoutError) as error:
+        sys.exit("error: %s" % error)
+
+
+if __name__ == "__main__":
+    main()